@@ -0,0 +1,251 @@
+// Producer/consumer throughput and latency benchmark for ComLib.
+// Runs one Producer and one Consumer process against the same shared ring.
+//
+//   ComLibBench [locked|lockfree|zerocopy|stream|batch] [messageSize] [messageCount] [messagesPerSecond]
+//       forks both sides (POSIX), runs every mode when none is given
+//   ComLibBench producer|consumer [locked|lockfree|zerocopy|stream|batch] [messageSize] [messageCount] [messagesPerSecond]
+//       one side per process, both have to use the same mode
+//
+// Only stream can send messages larger than a quarter of the ring.
+// batch packs batchLength messages into each record, small messages are where it pays off.
+// Add "wait" anywhere to have the consumer sleep on the doorbell instead of spinning.
+//
+// Without a rate the producer saturates the ring and latency includes queueing,
+// pass a rate to measure the latency of a link that keeps up.
+
+#include"Comlib.h"
+#include<algorithm>
+#include<chrono>
+#include<cstdlib>
+#include<functional>
+#include<vector>
+
+#ifndef _WIN32
+#include<sys/mman.h>
+#include<sys/wait.h>
+#include<unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+const size_t megaByte(1024000ull);
+const size_t bufferSize(megaByte * 64ull);
+
+struct BenchMessage {
+	uint64_t sequence;
+	int64_t sendTime;
+};
+
+enum class BenchMode {
+	Locked,
+	LockFree,
+	ZeroCopy,
+	Stream,
+	Batch
+};
+
+const char* modeNames[] = {"locked", "lockfree", "zerocopy", "stream", "batch"};
+const int modeCount(5);
+const uint64_t batchLength(64ull);
+
+struct BenchConfig {
+	BenchMode mode = BenchMode::LockFree;
+	size_t messageSize = 256ull;
+	size_t messageCount = 1000000ull;
+	size_t messagesPerSecond = 0ull;
+	bool wait = false;
+};
+
+const char* ModeName(const BenchConfig& config) {
+	return modeNames[(int)config.mode];
+}
+
+RingMode GetRingMode(const BenchConfig& config) {
+	return (config.mode == BenchMode::Locked) ? RingMode::Locked : RingMode::LockFree;
+}
+
+int64_t Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+int RunProducer(Comlib& com, const BenchConfig& config) {
+	std::vector<char> message(config.messageSize, 'x');
+	MessageHeader header;
+	size_t retries(0ull);
+
+	Clock::time_point start = Clock::now();
+	for(uint64_t i = 0ull; i < config.messageCount; i++) {
+		if(config.messagesPerSecond) {
+			Clock::time_point sendAt = start + std::chrono::nanoseconds(i * 1000000000ull / config.messagesPerSecond);
+			while(Clock::now() < sendAt);
+		}
+
+		if(config.mode == BenchMode::ZeroCopy) {
+			void* data(nullptr);
+			while(!(data = com.Reserve(config.messageSize))) retries++;
+			memset(data, 'x', config.messageSize);
+			((BenchMessage*)data)->sequence = i;
+			((BenchMessage*)data)->sendTime = Now();
+			com.Commit();
+			continue;
+		}
+
+		BenchMessage* msg = (BenchMessage*)message.data();
+		msg->sequence = i;
+		msg->sendTime = Now();
+		if(config.mode == BenchMode::Stream) {
+			while(!com.SendStream(message.data(), config.messageSize)) retries++;
+			continue;
+		}
+
+		if(config.mode == BenchMode::Batch) {
+			while(!com.SendBatched(message.data(), config.messageSize)) retries++;
+			if(i % batchLength == batchLength - 1ull || i + 1ull == config.messageCount)
+				com.FlushBatch();
+			continue;
+		}
+
+		header.messageLength = config.messageSize;
+		while(!com.Send(message.data(), &header)) {
+			header.messageLength = config.messageSize;
+			retries++;
+		}
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	Print("Producer [{0}]: {1} messages in {2} s, {3} failed sends.\n", ModeName(config), config.messageCount, seconds, retries);
+	return 0;
+}
+
+int RunConsumer(Comlib& com, const BenchConfig& config) {
+	std::vector<char> message(config.messageSize);
+	std::vector<int64_t> latency(config.messageCount);
+	uint64_t expected(0ull);
+	size_t errors(0ull);
+
+	// Copies out with Recieve, or reads in place with Peek/Release.
+	std::function<BenchMessage*()> next([&]() {
+		while(!com.Recieve(message.data()))
+			if(config.wait) com.WaitForMessage(~0u);
+		return (BenchMessage*)message.data();
+	});
+	bool inPlace = config.mode == BenchMode::ZeroCopy || config.mode == BenchMode::Stream || config.mode == BenchMode::Batch;
+	if(inPlace) next = [&]() {
+		size_t length(0ull);
+		void* data(nullptr);
+		while(!(data = com.Peek(length)))
+			if(config.wait) com.WaitForMessage(~0u);
+		return (BenchMessage*)data;
+	};
+
+	BenchMessage* msg = next();
+	Clock::time_point start = Clock::now();
+
+	for(;;) {
+		latency[expected] = Now() - msg->sendTime;
+		if(msg->sequence != expected) errors++;
+		if(inPlace) com.Release();
+		if(++expected == config.messageCount) break;
+		msg = next();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::sort(latency.begin(), latency.end());
+	double p50 = latency[latency.size() / 2ull] / 1000.0;
+	double p99 = latency[latency.size() * 99ull / 100ull] / 1000.0;
+
+	double mbPerSecond = (double)(config.messageSize * config.messageCount) / (1024.0 * 1024.0) / seconds;
+	Print("Consumer [{0}{1}]: {2} messages of {3} bytes in {4} s\n", ModeName(config), config.wait ? ", wait" : "", config.messageCount, config.messageSize, seconds);
+	Print("  {0} msg/s, {1} MB/s, p50 {2} us, p99 {3} us, {4} out of order\n", (double)config.messageCount / seconds, mbPerSecond, p50, p99, errors);
+	return errors ? 1 : 0;
+}
+
+#ifndef _WIN32
+int RunForked(const BenchConfig& config) {
+	// Start from a clean segment so a previous run can't leave a stale head/tail behind.
+	shm_unlink(ToShmName(L"ComLibBench").c_str());
+	shm_unlink(ToShmName(L"ComLibBench_ctrBuffer").c_str());
+
+	Comlib* producer = NEW Comlib(L"ComLibBench", bufferSize, ProcessType::Producer, GetRingMode(config));
+	if(config.mode != BenchMode::Stream && config.messageSize > producer->GetMaxMessageLength()) {
+		Print("Skipping {0}, {1} bytes is larger than the largest whole message.\n", ModeName(config), config.messageSize);
+		delete producer;
+		return 0;
+	}
+	std::cout.flush();
+
+	pid_t pid = fork();
+	if(pid == 0) {
+		Comlib com(L"ComLibBench", bufferSize, ProcessType::Consumer, GetRingMode(config));
+		int result = RunConsumer(com, config);
+		std::cout.flush();
+		_exit(result);
+	}
+
+	int result = RunProducer(*producer, config);
+	int status(0);
+	waitpid(pid, &status, 0);
+	delete producer;
+
+	shm_unlink(ToShmName(L"ComLibBench").c_str());
+	shm_unlink(ToShmName(L"ComLibBench_ctrBuffer").c_str());
+
+	return (result || !WIFEXITED(status)) ? 1 : WEXITSTATUS(status);
+}
+#endif
+
+int main(int argc, char** argv) {
+	BenchConfig config;
+	std::vector<char*> args;
+	for(int i = 0; i < argc; i++) {
+		if(std::string(argv[i]) == "wait") config.wait = true;
+		else args.push_back(argv[i]);
+	}
+	argc = (int)args.size();
+	argv = args.data();
+
+	int arg(1);
+	std::string role;
+	if(argc > arg && (std::string(argv[arg]) == "producer" || std::string(argv[arg]) == "consumer"))
+		role = argv[arg++];
+
+	bool allModes(true);
+	for(int i = 0; i < modeCount && argc > arg; i++)
+		if(std::string(argv[arg]) == modeNames[i]) {
+			config.mode = (BenchMode)i;
+			allModes = false;
+			arg++;
+			break;
+		}
+
+	if(argc > arg) config.messageSize = strtoull(argv[arg++], nullptr, 10);
+	if(argc > arg) config.messageCount = strtoull(argv[arg++], nullptr, 10);
+	if(argc > arg) config.messagesPerSecond = strtoull(argv[arg++], nullptr, 10);
+	if(config.messageSize < sizeof(BenchMessage)) config.messageSize = sizeof(BenchMessage);
+	if(config.messageCount == 0ull) config.messageCount = 1ull;
+
+	if(role == "producer") {
+		Comlib com(L"ComLibBench", bufferSize, ProcessType::Producer, GetRingMode(config));
+		return RunProducer(com, config);
+	}
+
+	if(role == "consumer") {
+		Comlib com(L"ComLibBench", bufferSize, ProcessType::Consumer, GetRingMode(config));
+		return RunConsumer(com, config);
+	}
+
+#ifdef _WIN32
+	Print("Start one \"ComLibBench producer\" and one \"ComLibBench consumer\" process.\n");
+	return 1;
+#else
+	if(!allModes)
+		return RunForked(config);
+
+	int result(0);
+	for(int i = 0; i < modeCount; i++) {
+		config.mode = (BenchMode)i;
+		result |= RunForked(config);
+	}
+	return result;
+#endif
+}
@@ -0,0 +1,205 @@
+// Checks and times the SSE MathUtil kernels against the scalar ones they replace.
+//
+//   MathBench [test|bench] [iterations]
+//       runs both when neither is given
+//
+// test compares every kernel on random inputs, including dst aliasing an input, and fails on any
+// result more than maxUlps apart. The kernels sum in the scalar order, so 0 is expected.
+// bench times each kernel over a batch of matrices and vectors, as Matrix, Vector3 and Vector4 call them.
+// Quaternion doesn't go through MathUtil, so it has nothing to compare.
+// Build with -mavx to test the AVX matrix product.
+
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<algorithm>
+#include<random>
+#include<string>
+#include<vector>
+#include<emmintrin.h>
+#ifdef __AVX__
+#include<immintrin.h>
+#endif
+
+#define MATRIX_SIZE (sizeof(float) * 16)
+
+// The kernels are private to gameplay's MathUtil, so each backend is built into a copy of it with them public.
+#define DECLARE_MATHUTIL \
+	namespace gameplay { \
+	class MathUtil { \
+		public: \
+		static void addMatrix(const float* m, float scalar, float* dst); \
+		static void addMatrix(const float* m1, const float* m2, float* dst); \
+		static void subtractMatrix(const float* m1, const float* m2, float* dst); \
+		static void multiplyMatrix(const float* m, float scalar, float* dst); \
+		static void multiplyMatrix(const float* m1, const float* m2, float* dst); \
+		static void negateMatrix(const float* m, float* dst); \
+		static void transposeMatrix(const float* m, float* dst); \
+		static void transformVector4(const float* m, float x, float y, float z, float w, float* dst); \
+		static void transformVector4(const float* m, const float* v, float* dst); \
+		static void crossVector3(const float* v1, const float* v2, float* dst); \
+	}; \
+	}
+
+namespace scalar {
+DECLARE_MATHUTIL
+#include"MathUtil.inl"
+}
+
+namespace simd {
+DECLARE_MATHUTIL
+#include"MathUtilSSE.inl"
+}
+
+using Clock = std::chrono::steady_clock;
+using ScalarMath = scalar::gameplay::MathUtil;
+using SimdMath = simd::gameplay::MathUtil;
+
+const int64_t maxUlps(0);
+const size_t batchSize(1024ull);
+
+// name, floats written and the call, as Matrix, Vector3 and Vector4 make it.
+// a and b are two matrices or vectors, aliased runs write over a.
+#define KERNELS(K) \
+	K("addMatrix scalar", 16, addMatrix(a, b[0], dst)) \
+	K("addMatrix", 16, addMatrix(a, b, dst)) \
+	K("subtractMatrix", 16, subtractMatrix(a, b, dst)) \
+	K("multiplyMatrix scalar", 16, multiplyMatrix(a, b[0], dst)) \
+	K("multiplyMatrix", 16, multiplyMatrix(a, b, dst)) \
+	K("negateMatrix", 16, negateMatrix(a, dst)) \
+	K("transposeMatrix", 16, transposeMatrix(a, dst)) \
+	K("transformVector4 xyzw", 3, transformVector4(a, b[0], b[1], b[2], b[3], dst)) \
+	K("transformVector4", 4, transformVector4(a, b, dst)) \
+	K("crossVector3", 3, crossVector3(a, b, dst))
+
+// Distance in representable floats, with -0 and 0 the same.
+int64_t UlpDistance(float a, float b) {
+	if(std::isnan(a) || std::isnan(b))
+		return (std::isnan(a) && std::isnan(b)) ? 0 : INT64_MAX;
+
+	int32_t ia, ib;
+	memcpy(&ia, &a, sizeof(ia));
+	memcpy(&ib, &b, sizeof(ib));
+	int64_t la = (ia < 0) ? (int64_t)INT32_MIN - ia : ia;
+	int64_t lb = (ib < 0) ? (int64_t)INT32_MIN - ib : ib;
+	return std::llabs(la - lb);
+}
+
+// Mostly ordinary transforms, with some values spread over a wide range of exponents.
+std::vector<float> RandomFloats(std::mt19937& random, size_t count) {
+	std::uniform_real_distribution<float> value(-10.f, 10.f);
+	std::uniform_int_distribution<int> exponent(-30, 30);
+	std::vector<float> floats(count);
+	for(size_t i = 0ull; i < count; i++)
+		floats[i] = (i % 7ull == 0ull) ? std::ldexp(value(random), exponent(random)) : value(random);
+	return floats;
+}
+
+// The kernels are passed as lambdas so they are inlined as they are in the engine.
+template<typename Scalar, typename Simd>
+bool TestKernel(const char* name, size_t outputSize, Scalar scalarRun, Simd simdRun, std::mt19937& random, size_t iterations) {
+	int64_t worst(0);
+
+	for(size_t i = 0ull; i < iterations; i++) {
+		std::vector<float> a = RandomFloats(random, 16ull);
+		std::vector<float> b = RandomFloats(random, 16ull);
+
+		float expected[16], result[16];
+		memset(expected, 0, sizeof(expected));
+		memset(result, 0, sizeof(result));
+		scalarRun(a.data(), b.data(), expected);
+		simdRun(a.data(), b.data(), result);
+
+		// Written over its first input, as Matrix::multiply(m) does.
+		float expectedAliased[16], aliased[16];
+		memcpy(expectedAliased, a.data(), sizeof(expectedAliased));
+		memcpy(aliased, a.data(), sizeof(aliased));
+		scalarRun(expectedAliased, b.data(), expectedAliased);
+		simdRun(aliased, b.data(), aliased);
+
+		for(size_t j = 0ull; j < outputSize; j++) {
+			worst = std::max(worst, UlpDistance(expected[j], result[j]));
+			worst = std::max(worst, UlpDistance(expectedAliased[j], aliased[j]));
+		}
+	}
+
+	bool passed = worst <= maxUlps;
+	printf("%-24s %s, at most %lld ulps apart\n", name, passed ? "passed" : "FAILED", (long long)worst);
+	return passed;
+}
+
+int RunTest(size_t iterations) {
+	std::mt19937 random(1234u);
+	int failures(0);
+
+#define TEST_KERNEL(name, size, call) \
+	if(!TestKernel(name, size, [](const float* a, const float* b, float* dst) { (void)b; ScalarMath::call; }, \
+		[](const float* a, const float* b, float* dst) { (void)b; SimdMath::call; }, random, iterations)) failures++;
+	KERNELS(TEST_KERNEL)
+#undef TEST_KERNEL
+
+	return failures ? 1 : 0;
+}
+
+template<typename Run>
+double TimeKernel(Run run, const std::vector<float>& a, const std::vector<float>& b, std::vector<float>& dst, size_t iterations) {
+	Clock::time_point start = Clock::now();
+	for(size_t i = 0ull; i < iterations; i++)
+		for(size_t j = 0ull; j < batchSize; j++)
+			run(&a[j * 16ull], &b[j * 16ull], &dst[j * 16ull]);
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double)(iterations * batchSize);
+}
+
+template<typename Scalar, typename Simd>
+void BenchKernel(const char* name, Scalar scalarRun, Simd simdRun, const std::vector<float>& a, const std::vector<float>& b,
+	std::vector<float>& dst, size_t iterations) {
+
+	// Warm up both before timing either.
+	TimeKernel(scalarRun, a, b, dst, iterations / 10ull + 1ull);
+	TimeKernel(simdRun, a, b, dst, iterations / 10ull + 1ull);
+
+	double scalarTime = TimeKernel(scalarRun, a, b, dst, iterations);
+	double simdTime = TimeKernel(simdRun, a, b, dst, iterations);
+	printf("%-24s %10.2f %10.2f %7.2fx\n", name, scalarTime, simdTime, scalarTime / simdTime);
+}
+
+int RunBench(size_t iterations) {
+	std::mt19937 random(5678u);
+	std::vector<float> a = RandomFloats(random, batchSize * 16ull);
+	std::vector<float> b = RandomFloats(random, batchSize * 16ull);
+	std::vector<float> dst(batchSize * 16ull);
+
+	printf("%-24s %10s %10s %8s\n", "kernel", "scalar ns", "simd ns", "speedup");
+
+#define BENCH_KERNEL(name, size, call) \
+	BenchKernel(name, [](const float* a, const float* b, float* dst) { (void)b; ScalarMath::call; }, \
+		[](const float* a, const float* b, float* dst) { (void)b; SimdMath::call; }, a, b, dst, iterations);
+	KERNELS(BENCH_KERNEL)
+#undef BENCH_KERNEL
+
+	// Keeps the results alive.
+	float sum(0.f);
+	for(float f : dst) sum += f;
+	return sum == 12345.f ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	std::string mode = (argc > 1) ? argv[1] : "";
+	size_t iterations = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 0ull;
+
+#ifdef __AVX__
+	printf("MathUtilSSE with the AVX matrix product.\n");
+#else
+	printf("MathUtilSSE with SSE2.\n");
+#endif
+
+	int result(0);
+	if(mode != "bench")
+		result |= RunTest(iterations ? iterations : 100000ull);
+	if(mode != "test")
+		result |= RunBench(iterations ? iterations : 2000ull);
+	return result;
+}
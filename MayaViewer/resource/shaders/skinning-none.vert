@@ -1,3 +1,51 @@
+#if defined(PACKED_VERTEX)
+
+// Positions carry the binormal sign in w, -1/1 or 0/1 when quantized.
+vec4 getPosition()
+{
+    #if defined(QUANTIZED_POSITION)
+    return vec4(u_positionOffset + a_position.xyz * u_positionScale, 1.0);
+    #else
+    return vec4(a_position.xyz, 1.0);
+    #endif
+}
+
+#if defined(LIGHTING)
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+vec3 getNormal()
+{
+    return decodeOctahedral(a_normal);
+}
+
+#if defined(BUMPED)
+vec3 getTangent()
+{
+    return decodeOctahedral(a_tangent);
+}
+
+vec3 getBinormal()
+{
+    #if defined(QUANTIZED_POSITION)
+    float binormalSign = a_position.w * 2.0 - 1.0;
+    #else
+    float binormalSign = a_position.w;
+    #endif
+    return cross(getNormal(), getTangent()) * binormalSign;
+}
+#endif
+
+#endif
+
+#else
+
 vec4 getPosition()
 {
     return a_position;    
@@ -22,4 +70,6 @@ vec3 getBinormal()
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
+
+#endif
@@ -27,12 +27,20 @@ attribute vec2 a_texCoord1;
 #endif
 
 #if defined(LIGHTING)
+#if defined(PACKED_VERTEX)
+attribute vec2 a_normal;
+#else
 attribute vec3 a_normal;
+#endif
 
 #if defined(BUMPED)
+#if defined(PACKED_VERTEX)
+attribute vec2 a_tangent;
+#else
 attribute vec3 a_tangent;
 attribute vec3 a_binormal;
 #endif
+#endif
 
 #endif
 
@@ -84,6 +92,11 @@ uniform mat4 u_worldMatrix;
 uniform vec4 u_clipPlane;
 #endif
 
+#if defined(QUANTIZED_POSITION)
+uniform vec3 u_positionOffset;
+uniform vec3 u_positionScale;
+#endif
+
 ///////////////////////////////////////////////////////////
 // Varyings
 varying vec2 v_texCoord;
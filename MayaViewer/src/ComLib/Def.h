@@ -1,9 +1,19 @@
 #pragma once
 
 #define __FILENAME__ (strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__)
+
+#ifdef _WIN32
 #define NEW new( _NORMAL_BLOCK, __FILE__, __LINE__)
 
 #define _CRTDBG_MAP_ALLOC
 #include<crtdbg.h>
 
-#define SET_DEBUG_FLAGS _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF)
\ No newline at end of file
+#define SET_DEBUG_FLAGS _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF)
+#else
+#define NEW new
+
+#define SET_DEBUG_FLAGS
+
+// Names are kept wide so the Comlib API is the same on every platform.
+typedef const wchar_t* LPCWSTR;
+#endif
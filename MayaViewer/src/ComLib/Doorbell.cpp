@@ -0,0 +1,61 @@
+#include "Doorbell.h"
+
+#ifndef _WIN32
+#include "Futex.h"
+#endif
+
+#ifdef _WIN32
+
+Doorbell::Doorbell(LPCWSTR doorbellName, std::atomic<uint32_t>* rings, std::atomic<uint32_t>* sleeping)
+	:m_eventHandle(), mp_rings(rings), mp_sleeping(sleeping) {
+
+	m_eventHandle = CreateEvent(nullptr, false, false, doorbellName);
+	if(!m_eventHandle) Print("ERROR: Failed to create Doorbell.\n");
+}
+
+Doorbell::~Doorbell() {
+	CloseHandle(m_eventHandle);
+}
+
+#else
+
+Doorbell::Doorbell(LPCWSTR /*doorbellName*/, std::atomic<uint32_t>* rings, std::atomic<uint32_t>* sleeping)
+	:mp_rings(rings), mp_sleeping(sleeping) {
+}
+
+Doorbell::~Doorbell() {
+}
+
+#endif
+
+void Doorbell::Ring() {
+	mp_rings->fetch_add(1u, std::memory_order_seq_cst);
+	if(!mp_sleeping->load(std::memory_order_seq_cst)) return;
+
+#ifdef _WIN32
+	SetEvent(m_eventHandle);
+#else
+	FutexWake(mp_rings, 1);
+#endif
+}
+
+uint32_t Doorbell::Arm() {
+	uint32_t ticket = mp_rings->load(std::memory_order_seq_cst);
+	mp_sleeping->store(1u, std::memory_order_seq_cst);
+	return ticket;
+}
+
+void Doorbell::Wait(uint32_t ticket, uint32_t timeoutMs) {
+	// A ring after Arm either changed the count or saw the sleeper flag, so it can't be missed.
+	if(mp_rings->load(std::memory_order_seq_cst) == ticket) {
+#ifdef _WIN32
+		WaitForSingleObject(m_eventHandle, (timeoutMs == ~0u) ? INFINITE : timeoutMs);
+#else
+		FutexWait(mp_rings, ticket, timeoutMs);
+#endif
+	}
+}
+
+void Doorbell::Disarm() {
+	mp_sleeping->store(0u, std::memory_order_relaxed);
+}
@@ -1,8 +1,20 @@
 #pragma once
 #include"CustomPrint.h"
+#include<cstdint>
 
 // Header for sending information about next message
+// messageID: 0 wrap marker, 1 whole message, 2 fragment of a streamed message, 3 batch of messages.
+// A batch holds whole messages back to back, each with its own header and padded like a record.
 struct MessageHeader {
 	size_t messageID;
 	size_t messageLength;
+};
+
+// Leads every fragment, followed by the fragment data.
+// Fragments of one message are sent back to back, offset 0 starts a new message.
+struct FragmentHeader {
+	uint64_t totalLength;
+	uint64_t offset;
+	uint32_t sequence;
+	uint32_t padding;
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "Memory.h"
 
+#ifdef _WIN32
+
 Memory::Memory(LPCWSTR bufferName, LPCWSTR ctrlBName, size_t bufferSize)
 	:m_memoryFilemap(), m_controlFilemap(), mp_memoryData(nullptr), mp_controlData(nullptr),
 	m_bufferSize(bufferSize), m_controlbufferSize(sizeof(ControlHeader)), m_bufferName(bufferName), m_ctrlbufferName(ctrlBName) {
@@ -23,7 +25,7 @@ Memory::Memory(LPCWSTR bufferName, LPCWSTR ctrlBName, size_t bufferSize)
 	if(!m_controlFilemap)
 		Print("ERROR: Failed to create Control File Mapping.\n");
 	else 
-		mp_controlData = (size_t*)MapViewOfFile(m_controlFilemap, FILE_MAP_ALL_ACCESS, 0ul, 0ul, m_controlbufferSize);
+		mp_controlData = (ControlHeader*)MapViewOfFile(m_controlFilemap, FILE_MAP_ALL_ACCESS, 0ul, 0ul, m_controlbufferSize);
 
 	if(!mp_controlData) Print("ERROR: View of File Mapping failed.\n");
 }
@@ -35,3 +37,76 @@ Memory::~Memory() {
 	UnmapViewOfFile(mp_controlData);
 	CloseHandle(m_controlFilemap);
 }
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+
+int OpenSharedFile(const std::string& name, size_t size, bool& linked) {
+	linked = false;
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+	if(fd == -1 && errno == EEXIST) {
+		linked = true;
+		fd = shm_open(name.c_str(), O_RDWR, 0666);
+	}
+	if(fd == -1) return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) == -1 || (static_cast<size_t>(st.st_size) < size && ftruncate(fd, (off_t)size) == -1)) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void* MapSharedFile(int fd, size_t size) {
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	return (data == MAP_FAILED) ? nullptr : data;
+}
+
+Memory::Memory(LPCWSTR bufferName, LPCWSTR ctrlBName, size_t bufferSize)
+	:m_memoryFilemap(-1), m_controlFilemap(-1), mp_memoryData(nullptr), mp_controlData(nullptr),
+	m_bufferSize(bufferSize), m_controlbufferSize(sizeof(ControlHeader)), m_bufferName(bufferName), m_ctrlbufferName(ctrlBName) {
+
+	bool linked(false);
+
+	// Main File map
+	m_memoryFilemap = OpenSharedFile(ToShmName(bufferName), bufferSize, linked);
+	if(linked) Print("File Mapping is linked.\n");
+
+	if(m_memoryFilemap == -1)
+		Print("ERROR: Failed to create File Mapping.\n");
+	else
+		mp_memoryData = (char*)MapSharedFile(m_memoryFilemap, bufferSize);
+
+	if(!mp_memoryData) Print("ERROR: View of File Mapping failed.\n");
+
+
+	// Control File Map
+	m_controlFilemap = OpenSharedFile(ToShmName(m_ctrlbufferName), m_controlbufferSize, linked);
+	if(linked) Print("Control File Map is linked.\n");
+
+	if(m_controlFilemap == -1)
+		Print("ERROR: Failed to create Control File Mapping.\n");
+	else
+		mp_controlData = (ControlHeader*)MapSharedFile(m_controlFilemap, m_controlbufferSize);
+
+	if(!mp_controlData) Print("ERROR: View of File Mapping failed.\n");
+}
+
+Memory::~Memory() {
+	// The names are left in place so the other process can keep linking to them,
+	// same lifetime as a named file mapping that is reopened while still in use.
+	if(mp_memoryData) munmap(mp_memoryData, m_bufferSize);
+	if(m_memoryFilemap != -1) close(m_memoryFilemap);
+
+	if(mp_controlData) munmap(mp_controlData, m_controlbufferSize);
+	if(m_controlFilemap != -1) close(m_controlFilemap);
+}
+
+#endif
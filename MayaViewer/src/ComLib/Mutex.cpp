@@ -1,5 +1,6 @@
 #include "Mutex.h"
 
+#ifdef _WIN32
 
 Mutex::Mutex(LPCWSTR mutexName)
 	:m_mutexHandle() {
@@ -23,3 +24,54 @@ void Mutex::Lock() {
 void Mutex::Unlock() {
 	ReleaseMutex(m_mutexHandle);
 }
+
+#else
+
+#include "Futex.h"
+#include "Memory.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+Mutex::Mutex(LPCWSTR mutexName)
+	:m_mutexHandle(-1), mp_state(nullptr) {
+
+	bool linked(false);
+	m_mutexHandle = OpenSharedFile(ToShmName(mutexName), sizeof(std::atomic<uint32_t>), linked);
+	if(linked) Print("Mutex linked.\n");
+
+	// A fresh segment is zero filled, which is the unlocked state.
+	if(m_mutexHandle != -1) {
+		void* data = mmap(nullptr, sizeof(std::atomic<uint32_t>), PROT_READ | PROT_WRITE, MAP_SHARED, m_mutexHandle, 0);
+		if(data != MAP_FAILED) mp_state = static_cast<std::atomic<uint32_t>*>(data);
+	}
+
+	if(!mp_state) Print("ERROR: Failed to create Mutex.\n");
+}
+
+Mutex::~Mutex() {
+	if(mp_state) munmap(mp_state, sizeof(std::atomic<uint32_t>));
+	if(m_mutexHandle != -1) close(m_mutexHandle);
+}
+
+void Mutex::Lock() {
+	uint32_t state(0u);
+	if(mp_state->compare_exchange_strong(state, 1u, std::memory_order_acquire))
+		return;
+
+	if(state != 2u)
+		state = mp_state->exchange(2u, std::memory_order_acquire);
+
+	while(state != 0u) {
+		FutexWait(mp_state, 2u);
+		state = mp_state->exchange(2u, std::memory_order_acquire);
+	}
+}
+
+void Mutex::Unlock() {
+	if(mp_state->fetch_sub(1u, std::memory_order_release) != 1u) {
+		mp_state->store(0u, std::memory_order_release);
+		FutexWake(mp_state, 1);
+	}
+}
+
+#endif
@@ -1,6 +1,11 @@
 #pragma once
 #include"CustomPrint.h"
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <atomic>
+#include <cstdint>
+#endif
 #include <iostream>
 
 class Mutex {
@@ -12,6 +17,12 @@ class Mutex {
 	void Unlock();
 
 	private:
+#ifdef _WIN32
 	HANDLE m_mutexHandle;
+#else
+	// 0 unlocked, 1 locked, 2 locked with waiters.
+	int m_mutexHandle;
+	std::atomic<uint32_t>* mp_state;
+#endif
 
 };
@@ -0,0 +1,215 @@
+#include "EventReceiver.h"
+#include "UploadScheduler.h"
+
+
+// Small events waiting at most, each slot holds one.
+const size_t eventSlots(1024ull);
+// Pooled buffers start this large, so most meshes fit without growing them.
+const size_t bufferReserve(64ull * 1024ull);
+
+EventReceiver::EventReceiver(Comlib& com, size_t maxQueuedBytes, size_t bufferCount)
+	:m_com(com), m_stop(true), m_events(eventSlots), m_buffers(bufferCount), m_freeBuffers(bufferCount), m_taken(false),
+	m_queuedBytes(0ull), m_maxQueuedBytes(maxQueuedBytes) {
+
+	for(EventBuffer& buffer : m_buffers) {
+		buffer.data.reserve(bufferReserve);
+		*m_freeBuffers.Back() = &buffer;
+		m_freeBuffers.Push();
+	}
+}
+
+EventReceiver::~EventReceiver() {
+	Stop();
+}
+
+void EventReceiver::Start() {
+	if(!m_stop) return;
+
+	m_stop = false;
+	m_thread = std::thread(&EventReceiver::Receive, this);
+}
+
+void EventReceiver::Stop() {
+	if(m_stop) return;
+
+	m_stop = true;
+	m_thread.join();
+}
+
+Event* EventReceiver::Next() {
+	Slot* slot = m_events.Front();
+	if(!slot) return nullptr;
+
+	return slot->buffer ? slot->buffer->GetEvent() : (Event*)slot->event;
+}
+
+void EventReceiver::Pop() {
+	Slot* slot = m_events.Front();
+	if(!slot) return;
+
+	if(slot->buffer && !m_taken)
+		Recycle(slot->buffer);
+	m_taken = false;
+	m_events.Pop();
+}
+
+EventBuffer* EventReceiver::Payload() {
+	Slot* slot = m_events.Front();
+	return (slot && !m_taken) ? slot->buffer : nullptr;
+}
+
+EventBuffer* EventReceiver::TakePayload() {
+	EventBuffer* buffer = Payload();
+	if(buffer) m_taken = true;
+	return buffer;
+}
+
+void EventReceiver::Recycle(EventBuffer* buffer) {
+	m_queuedBytes -= buffer->data.size();
+
+	// There are never more buffers out than the free queue holds.
+	*m_freeBuffers.Back() = buffer;
+	m_freeBuffers.Push();
+}
+
+void EventReceiver::Receive() {
+	while(!m_stop) {
+		Slot* slot = m_events.Back();
+		if(!slot || m_queuedBytes >= m_maxQueuedBytes) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		// Wakes up now and then to see if the viewer is closing.
+		if(!m_com.WaitForMessage(100u)) continue;
+
+		size_t length(0ull);
+		Event* event = (Event*)m_com.Peek(length);
+		if(!event) continue;
+
+		size_t smallLength(0ull);
+		if(!Validate(event, length, smallLength)) {
+			m_com.Release();
+			continue;
+		}
+
+		if(smallLength) {
+			slot->buffer = nullptr;
+			memcpy(slot->event, event, smallLength);
+		}
+		else {
+			// Left in the ring until a buffer comes back.
+			EventBuffer** free = m_freeBuffers.Front();
+			if(!free) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+			slot->buffer = *free;
+			m_freeBuffers.Pop();
+
+			slot->buffer->data.assign((char*)event, (char*)event + length);
+			m_queuedBytes += length;
+			Decode(*slot->buffer);
+		}
+
+		m_events.Push();
+		m_com.Release();
+	}
+}
+
+// The bounds the render thread would otherwise have to find on its vertices.
+void EventReceiver::Decode(EventBuffer& buffer) {
+	buffer.editBounds = false;
+
+	Event* event = buffer.GetEvent();
+	switch(event->GetType()) {
+		case EventType::MeshCreated: {
+			EventMeshCreated* e = (EventMeshCreated*)event;
+			GetMeshBounds(e->bounds, e->layout, e + 1, e->vertexCount, buffer.box, buffer.sphere);
+		} break;
+		case EventType::TopologyModified: {
+			EventTopologyModified* e = (EventTopologyModified*)event;
+			GetMeshBounds(e->bounds, e->layout, e + 1, e->vertexCount, buffer.box, buffer.sphere);
+		} break;
+		case EventType::VertexModified: {
+			EventVertexModified* e = (EventVertexModified*)event;
+			if(!e->rangeCount || e->bounds.radius >= 0.f) {
+				GetMeshBounds(e->bounds, e->layout, e + 1, e->rangeCount ? 0u : e->vertexCount, buffer.box, buffer.sphere);
+				break;
+			}
+
+			VertexRange* ranges = (VertexRange*)(e + 1);
+			const char* vertecies = (const char*)(ranges + e->rangeCount);
+			for(uint32_t i = 0u; i < e->rangeCount; i++) {
+				if(ranges[i].count) {
+					BoundingBox box = GetPositionBounds(e->layout, vertecies, ranges[i].count);
+					if(buffer.editBounds) buffer.box.merge(box);
+					else buffer.box = box;
+					buffer.editBounds = true;
+				}
+				vertecies += e->layout.VertexSize() * ranges[i].count;
+			}
+		} break;
+		default: break;
+	}
+}
+
+// Vertices followed by indices, 0 if the header doesn't make sense.
+template<typename T>
+size_t MeshEventLength(T* e, size_t length) {
+	if(length < sizeof(T) || e->layout.encoding > VertexEncoding::Quantized) return 0ull;
+	if(e->indexSize != 2u && e->indexSize != 4u) return 0ull;
+
+	return sizeof(T) + e->layout.VertexSize() * (uint64_t)e->vertexCount + e->indexSize * (uint64_t)e->indexCount;
+}
+
+// The whole buffer or the vertex ranges with their vertices, 0 if the header doesn't make sense.
+size_t VertexEventLength(EventVertexModified* e, size_t length) {
+	if(length < sizeof(EventVertexModified) || e->layout.encoding > VertexEncoding::Quantized) return 0ull;
+	if(!e->rangeCount)
+		return sizeof(EventVertexModified) + e->layout.VertexSize() * (uint64_t)e->vertexCount;
+
+	size_t rangeSize = sizeof(VertexRange) * (uint64_t)e->rangeCount;
+	if(length < sizeof(EventVertexModified) + rangeSize) return 0ull;
+
+	uint64_t vertexCount(0ull);
+	VertexRange* ranges = (VertexRange*)(e + 1);
+	for(uint32_t i = 0u; i < e->rangeCount; i++) {
+		if((uint64_t)ranges[i].start + ranges[i].count > e->vertexCount) return 0ull;
+		vertexCount += ranges[i].count;
+	}
+
+	return sizeof(EventVertexModified) + rangeSize + e->layout.VertexSize() * vertexCount;
+}
+
+// Events with a payload have to be exactly as long as their counts say, so the handlers can trust them.
+// Small events have no payload, smallLength is set to how much of them to keep.
+bool EventReceiver::Validate(Event* event, size_t length, size_t& smallLength) {
+	size_t minLength(0ull);
+	size_t expected(0ull);
+
+	if(length >= sizeof(Event)) {
+		switch(event->GetType()) {
+			case EventType::RefreshPlugin: minLength = sizeof(EventRefreshPlugin); break;
+			case EventType::MeshDeleted: minLength = sizeof(EventMeshDeleted); break;
+			case EventType::Transform: minLength = sizeof(EventTransform); break;
+			case EventType::MaterialModified: minLength = sizeof(EventMaterialModified); break;
+			case EventType::MaterialChanged: minLength = sizeof(EventMaterialChanged); break;
+			case EventType::MeshCreated: expected = MeshEventLength((EventMeshCreated*)event, length); break;
+			case EventType::TopologyModified: expected = MeshEventLength((EventTopologyModified*)event, length); break;
+			case EventType::VertexModified: expected = VertexEventLength((EventVertexModified*)event, length); break;
+			default: break;
+		}
+	}
+
+	smallLength = 0ull;
+	if(minLength && length >= minLength) {
+		smallLength = minLength;
+		return true;
+	}
+	if(expected && length == expected)
+		return true;
+
+	Print("ERROR: Dropping a malformed event of {0} bytes.\n", length);
+	return false;
+}
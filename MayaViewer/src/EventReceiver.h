@@ -0,0 +1,106 @@
+#pragma once
+#include"ComLib/Comlib.h"
+#include"EventHandler.h"
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<cstddef>
+#include<thread>
+#include<vector>
+
+// Bounded queue for exactly one producer thread and one consumer thread, without locks.
+// The producer fills Back and publishes it with Push, the consumer reads Front until Pop.
+template<typename T>
+class SpscQueue {
+	public:
+	explicit SpscQueue(size_t capacity)
+		:m_items(RoundUp(capacity)), m_mask(m_items.size() - 1ull), m_head(0ull), m_tail(0ull) {}
+
+	// Producer only, nullptr when full.
+	T* Back() {
+		size_t head = m_head.load(std::memory_order_relaxed);
+		return (head - m_tail.load(std::memory_order_acquire) <= m_mask) ? &m_items[head & m_mask] : nullptr;
+	}
+	void Push() {m_head.store(m_head.load(std::memory_order_relaxed) + 1ull, std::memory_order_release);}
+
+	// Consumer only, nullptr when empty.
+	T* Front() {
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		return (m_head.load(std::memory_order_acquire) != tail) ? &m_items[tail & m_mask] : nullptr;
+	}
+	void Pop() {m_tail.store(m_tail.load(std::memory_order_relaxed) + 1ull, std::memory_order_release);}
+
+	private:
+	static size_t RoundUp(size_t capacity) {
+		size_t size(1ull);
+		while(size < capacity) size <<= 1;
+		return size;
+	}
+
+	std::vector<T> m_items;
+	const size_t m_mask;
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+};
+
+// A mesh or vertex event copied out of the ring, with the bounds of its vertices already worked out.
+// The buffers come from a pool and keep their capacity, so a new event only allocates if it is the largest yet.
+struct EventBuffer {
+	std::vector<char> data;
+	BoundingBox box;
+	BoundingSphere sphere;
+	// Vertex edits without sent bounds: box only covers the edited vertices, if there were any.
+	bool editBounds = false;
+
+	Event* GetEvent() {return (Event*)data.data();}
+};
+
+// Reads the ring on a thread of its own, so copying a large message out of it, checking it and
+// finding its bounds doesn't stall a frame. Events reach the render thread in order through one
+// lock-free queue: small ones are copied into its slots, the others into a pooled EventBuffer.
+// The reader stops taking messages once maxQueuedBytes of buffers are out of the pool, or all of
+// them are, which holds the plugin back.
+class EventReceiver {
+	public:
+	EventReceiver(Comlib& com, size_t maxQueuedBytes, size_t bufferCount = 256ull);
+	~EventReceiver();
+
+	void Start();
+	void Stop();
+
+	// Render thread only. Next returns the oldest received event, or nullptr if there is none.
+	// It stays valid until Pop.
+	Event* Next();
+	void Pop();
+
+	// The buffer of the current event, nullptr for small events.
+	EventBuffer* Payload();
+	// Keeps the current event's buffer past Pop, it goes back to the pool with Recycle.
+	EventBuffer* TakePayload();
+	void Recycle(EventBuffer* buffer);
+
+	private:
+	static constexpr size_t smallEventSize = std::max({sizeof(EventRefreshPlugin), sizeof(EventMeshDeleted),
+		sizeof(EventTransform), sizeof(EventMaterialModified), sizeof(EventMaterialChanged)});
+
+	struct Slot {
+		EventBuffer* buffer;
+		alignas(std::max_align_t) char event[smallEventSize];
+	};
+
+	void Receive();
+	bool Validate(Event* event, size_t length, size_t& smallLength);
+	void Decode(EventBuffer& buffer);
+
+	Comlib& m_com;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+
+	SpscQueue<Slot> m_events;
+	std::vector<EventBuffer> m_buffers;
+	SpscQueue<EventBuffer*> m_freeBuffers;
+	bool m_taken;
+
+	std::atomic<size_t> m_queuedBytes;
+	const size_t m_maxQueuedBytes;
+};
@@ -1,4 +1,6 @@
 #include "MayaViewer.h"
+#include "EventReceiver.h"
+#include "UploadScheduler.h"
 #include<thread>
 
 
@@ -6,10 +8,84 @@
 MayaViewer game;
 
 const size_t megaByte(1024000ull);
-Comlib com(L"MayaViewer", megaByte * 500ull, ProcessType::Consumer);
+Comlib com(L"MayaViewer", megaByte * 32ull, ProcessType::Consumer);
 Comlib comRefresh(L"RefreshPlugin", megaByte, ProcessType::Producer);
+EventReceiver receiver(com, megaByte * 256ull);
+UploadScheduler uploads;
 MessageHeader messageHeader;
-std::map<std::string, std::map<std::string, Material*>> materials;
+// Scene nodes by mesh handle.
+std::unordered_map<ObjectHandle, Node*> nodes;
+
+
+// Colors and textures of a Maya shader, shared by the materials of all meshes using it.
+// Their parameters are bound to it, so changing the shader only changes this.
+class ShaderParameters {
+	public:
+	ShaderParameters()
+		:m_color(Vector4::one()), m_ambientColor(Vector3::zero()), m_diffuseTexture(nullptr), m_normalTexture(nullptr) {}
+
+	ShaderParameters(const ShaderParameters&) = delete;
+	ShaderParameters& operator=(const ShaderParameters&) = delete;
+
+	~ShaderParameters() {
+		SAFE_RELEASE(m_diffuseTexture);
+		SAFE_RELEASE(m_normalTexture);
+	}
+
+	void Set(const Vector4& color, const Vector3& ambientColor, const char* textureFilePath, const char* normalFilePath) {
+		m_color = color;
+		m_ambientColor = ambientColor;
+		SetTexture(m_diffuseTexture, textureFilePath, "resource/DefaultTexture.png");
+		SetTexture(m_normalTexture, normalFilePath, "resource/DefaultNormal.png");
+	}
+
+	// Binds the shader's parameters of a mesh material to this.
+	void Bind(Material* material) {
+		material->getParameter("u_diffuseColor")->bindValue(this, &ShaderParameters::GetColor);
+		material->getParameter("u_ambientColor")->bindValue(this, &ShaderParameters::GetAmbientColor);
+		material->getParameter("u_diffuseTexture")->bindValue(this, &ShaderParameters::GetDiffuseTexture);
+		material->getParameter("u_normalmapTexture")->bindValue(this, &ShaderParameters::GetNormalTexture);
+	}
+
+	const Vector4& GetColor() const {return m_color;}
+	const Vector3& GetAmbientColor() const {return m_ambientColor;}
+	const Texture::Sampler* GetDiffuseTexture() const {return m_diffuseTexture;}
+	const Texture::Sampler* GetNormalTexture() const {return m_normalTexture;}
+
+	// Materials of the meshes using the shader, by mesh handle.
+	std::unordered_map<ObjectHandle, Material*> meshes;
+
+	private:
+	static void SetTexture(Texture::Sampler*& sampler, const char* filePath, const char* defaultPath) {
+		Texture::Sampler* texture = Texture::Sampler::create(filePath[0] ? filePath : defaultPath, true, true);
+		if(!texture) return;
+
+		texture->setFilterMode(Texture::NEAREST_MIPMAP_LINEAR, Texture::LINEAR);
+		texture->setWrapMode(Texture::Wrap::REPEAT, Texture::Wrap::REPEAT);
+		SAFE_RELEASE(sampler);
+		sampler = texture;
+	}
+
+	Vector4 m_color;
+	Vector3 m_ambientColor;
+	Texture::Sampler* m_diffuseTexture;
+	Texture::Sampler* m_normalTexture;
+};
+
+// By shader handle.
+std::unordered_map<ObjectHandle, ShaderParameters> shaders;
+
+// The shader's parameters, set from the first event that names it.
+template<typename T>
+ShaderParameters& GetShader(ObjectHandle handle, const T& e) {
+	auto shader = shaders.find(handle);
+	if(shader != shaders.end())
+		return shader->second;
+
+	ShaderParameters& created = shaders[handle];
+	created.Set(e.color, e.ambientColor, e.textureFilePath, e.normalFilePath);
+	return created;
+}
 
 
 struct Vertex {
@@ -22,26 +98,68 @@ struct Vertex {
 	Vertex() : position(Vector3::zero()), normal(Vector3::zero()), texcoord(Vector2::zero()) {}
 };
 
-Mesh* CreateMesh(Vertex* meshData, uint32_t vertexCount) {
-	VertexFormat::Element elements[] = {
-		VertexFormat::Element(VertexFormat::POSITION, 3),
-		VertexFormat::Element(VertexFormat::NORMAL, 3),
-		VertexFormat::Element(VertexFormat::TANGENT, 3),
-		VertexFormat::Element(VertexFormat::BINORMAL, 3),
-		VertexFormat::Element(VertexFormat::TEXCOORD0, 2)
-	};
-	Mesh* mesh = Mesh::createMesh(VertexFormat(elements, 5), vertexCount, true);
+// Shader defines that decode the vertex layout.
+const char* GetVertexDefines(const VertexLayout& layout) {
+	switch(layout.encoding) {
+		case VertexEncoding::Packed: return "BUMPED;DIRECTIONAL_LIGHT_COUNT 1;PACKED_VERTEX";
+		case VertexEncoding::Quantized: return "BUMPED;DIRECTIONAL_LIGHT_COUNT 1;PACKED_VERTEX;QUANTIZED_POSITION";
+		default: return "BUMPED;DIRECTIONAL_LIGHT_COUNT 1";
+	}
+}
+
+// Quantized positions are decoded with the bounds they were quantized in.
+void SetPositionBounds(Material* material, const VertexLayout& layout) {
+	if(layout.encoding == VertexEncoding::Quantized) {
+		material->getParameter("u_positionOffset")->setValue(layout.positionOffset);
+		material->getParameter("u_positionScale")->setValue(layout.positionScale);
+	}
+}
+
+Mesh* CreateMesh(const VertexLayout& layout, const void* meshData, uint32_t vertexCount, uint32_t indexCount, uint32_t indexSize) {
+	Mesh* mesh = Mesh::createMesh(GetVertexFormat(layout), vertexCount, true);
 	if(mesh == nullptr) {
 		GP_ERROR("Failed to create mesh.");
 		return nullptr;
 	}
 	mesh->setVertexData(meshData, 0, vertexCount);
+
+	// Indices follow the vertices.
+	Mesh::IndexFormat indexFormat = (indexSize == 2u) ? Mesh::INDEX16 : Mesh::INDEX32;
+	MeshPart* part = mesh->addPart(Mesh::TRIANGLES, indexFormat, indexCount, true);
+	part->setIndexData((const char*)meshData + layout.VertexSize() * vertexCount, 0, indexCount);
 	return mesh;
 }
 
 
+// Makes the model and material of an uploaded mesh, in place of its placeholder.
+void FinishMesh(Node* node, Mesh* mesh, EventMeshCreated& e) {
+	Model* model = Model::create(mesh);
+
+	Material* material = model->setMaterial("resource/shaders/textured.vert", "resource/shaders/Custom.frag", GetVertexDefines(e.layout));
+	SetPositionBounds(material, e.layout);
+	material->setParameterAutoBinding("u_worldViewProjectionMatrix", "WORLD_VIEW_PROJECTION_MATRIX");
+	material->setParameterAutoBinding("u_inverseTransposeWorldViewMatrix", "INVERSE_TRANSPOSE_WORLD_VIEW_MATRIX");
+	material->getParameter("u_directionalLightColor[0]")->setValue(Vector3(0.6f, 0.6f, 0.6f));
+	material->getParameter("u_directionalLightDirection[0]")->setValue(Vector3(0.f, 0.f, -1.f));
+	material->getStateBlock()->setCullFace(true);
+	material->getStateBlock()->setDepthTest(true);
+
+	ShaderParameters& shader = GetShader(e.shader, e);
+	shader.Bind(material);
+	shader.meshes.emplace(e.handle, material);
+
+	node->setDrawable(model);
+	SAFE_RELEASE(model);
+}
+
+Node* FindNode(ObjectHandle handle) {
+	auto node = nodes.find(handle);
+	return (node != nodes.end()) ? node->second : nullptr;
+}
+
+
 MayaViewer::MayaViewer()
-    : _scene(NULL) {
+    : _scene(NULL), _eventBudget(4.f), _uploadBudget(4.f), _statsFont(NULL), _visibleCount(0u), _culledCount(0u) {
 }
 
 void MayaViewer::initialize() {
@@ -49,8 +167,19 @@ void MayaViewer::initialize() {
 	SET_DEBUG_FLAGS;
 
 	Game::setVsync(true);
-	gameplay::
-	Properties* conf = Game::getConfig();
+	// Milliseconds per frame spent applying events from the plugin.
+	Properties* conf = Game::getConfig()->getNamespace("viewer", true);
+	if(conf && conf->exists("eventBudget"))
+		_eventBudget = conf->getFloat("eventBudget");
+
+	// Milliseconds per frame spent uploading new meshes.
+	if(conf && conf->exists("uploadBudget"))
+		_uploadBudget = conf->getFloat("uploadBudget");
+
+	// Drawn and culled mesh counts in the corner.
+	if(conf && conf->getBool("showCullStats"))
+		_statsFont = Font::create("resource/ui/arial.gpb");
+
     _scene = Scene::create();
 	
 	Camera* camera = Camera::createPerspective(45.f, getAspectRatio(), 0.01f, 2000.f);
@@ -60,6 +189,9 @@ void MayaViewer::initialize() {
 	SAFE_RELEASE(camera);
 
 	com.ClearMemory();
+	uploads.SetFinish(FinishMesh);
+	uploads.SetRecycle([](EventBuffer* buffer) { receiver.Recycle(buffer); });
+	receiver.Start();
 
 	EventRefreshPlugin e;
 	messageHeader.messageLength = sizeof(e);
@@ -67,6 +199,11 @@ void MayaViewer::initialize() {
 }
 
 void MayaViewer::finalize() {
+	receiver.Stop();
+	uploads.Clear();
+	nodes.clear();
+	shaders.clear();
+	SAFE_RELEASE(_statsFont);
     SAFE_RELEASE(_scene);
 }
 
@@ -74,90 +211,28 @@ void MayaViewer::EventCallback(Event* event) {
 
 	EventDispatcher addMesh(event);
 	addMesh.Dispatch<EventMeshCreated>([&](EventMeshCreated& e) {
-		Vertex* vertecies = NEW Vertex[e.vertexCount];
-		memcpy(vertecies, &e + 1ull, sizeof(Vertex) * e.vertexCount);
-
-		Mesh* mesh = CreateMesh(vertecies, e.vertexCount);
-		Model* model = Model::create(mesh);
-		
-		Material* material = model->setMaterial("resource/shaders/textured.vert", "resource/shaders/Custom.frag", "BUMPED;DIRECTIONAL_LIGHT_COUNT 1");
-		material->setParameterAutoBinding("u_worldViewProjectionMatrix", "WORLD_VIEW_PROJECTION_MATRIX");
-		material->setParameterAutoBinding("u_inverseTransposeWorldViewMatrix", "INVERSE_TRANSPOSE_WORLD_VIEW_MATRIX");
-		material->getParameter("u_ambientColor")->setValue(e.ambientColor);
-		material->getParameter("u_diffuseColor")->setValue(e.color);
-		material->getParameter("u_directionalLightColor[0]")->setValue(Vector3(0.6f, 0.6f, 0.6f));
-		material->getParameter("u_directionalLightDirection[0]")->setValue(Vector3(0.f, 0.f, -1.f));
-		material->getStateBlock()->setCullFace(true);
-		material->getStateBlock()->setDepthTest(true);
-
-		Texture::Sampler* sampler;
-		std::string filePath(e.textureFilePath);
-		if(!filePath.empty())
-			sampler = material->getParameter("u_diffuseTexture")->setValue(filePath.c_str(), true);
-		else
-			sampler = material->getParameter("u_diffuseTexture")->setValue("resource/DefaultTexture.png", true);
-		sampler->setFilterMode(Texture::NEAREST_MIPMAP_LINEAR, Texture::LINEAR);
-		sampler->setWrapMode(Texture::Wrap::REPEAT, Texture::Wrap::REPEAT);
-
-		filePath = e.normalFilePath;
-		if(!filePath.empty())
-			sampler = material->getParameter("u_normalmapTexture")->setValue(filePath.c_str(), true);
-		else
-			sampler = material->getParameter("u_normalmapTexture")->setValue("resource/DefaultNormal.png", true);
-		sampler->setFilterMode(Texture::NEAREST_MIPMAP_LINEAR, Texture::LINEAR);
-		sampler->setWrapMode(Texture::Wrap::REPEAT, Texture::Wrap::REPEAT);
-
-
-		if(!materials.count(e.shaderName))
-			materials.emplace(e.shaderName, std::map<std::string, Material*>());
-
-		materials.at(e.shaderName).emplace(e.name, material);
-
-		std::string name(e.name);
-		Node* node = _scene->addNode(name.c_str());
-		node->setDrawable(model);
+		Node* node = _scene->addNode();
 		node->translate(0.f, 0.f, 0.f);
-		SAFE_RELEASE(model);
-		SAFE_RELEASE(mesh);
-
-		delete[] vertecies;
+		nodes[e.handle] = node;
+		uploads.Add(receiver.TakePayload(), node);
 	});
 
 	EventDispatcher removeMesh(event);
 	removeMesh.Dispatch<EventMeshDeleted>([&](EventMeshDeleted& e) {
-		Node* node = _scene->findNode(e.name);
-		if(node) {
-			_scene->removeNode(node);
-			materials.at(e.shaderName).erase(e.name);
-		}
-	});
-
-	EventDispatcher nameChanged(event);
-	nameChanged.Dispatch<EventNameChanged>([&](EventNameChanged& e) {
-		Node* node = _scene->findNode(e.previousName);
-		if(node) {
-			node->setId(e.newName);
-
-			std::string materialName;
-			Material* material(nullptr);
-
-			for(auto& [key, i] : materials)
-				if(i.count(e.previousName)) {
-					materialName = key;
-					material = i.at(e.previousName);
-					i.erase(e.previousName);
-					break;
-				}
-
-			if(material)
-				materials.at(materialName).emplace(e.newName, material);
+		uploads.Cancel(e.handle);
+
+		auto node = nodes.find(e.handle);
+		if(node != nodes.end()) {
+			_scene->removeNode(node->second);
+			nodes.erase(node);
+			for(auto& [key, i] : shaders)
+				i.meshes.erase(e.handle);
 		}
 	});
 
 	EventDispatcher objectMoved(event);
 	objectMoved.Dispatch<EventTransform>([&](EventTransform& e) {
-		std::string name(e.name);
-		Node* node = _scene->findNode(name.c_str());
+		Node* node = FindNode(e.handle);
 		Vector3 translation;
 		Quaternion rotation;
 		Vector3 scale;
@@ -172,7 +247,7 @@ void MayaViewer::EventCallback(Event* event) {
 			Camera* cam = _scene->getActiveCamera();
 			Matrix proj;
 			float fov = MATH_RAD_TO_DEG(e.fov);
-			if(name.find("persp") != std::string::npos)
+			if(!e.isOrthographic)
 				Matrix::createPerspective(fov, getAspectRatio(), 0.01f, 2000.f, &proj);
 			else
 				Matrix::createOrthographic(e.orthoWidth, e.orthoWidth / getAspectRatio(), 0.01f, 2000.f, &proj);
@@ -188,63 +263,37 @@ void MayaViewer::EventCallback(Event* event) {
 
 	EventDispatcher materialModified(event);
 	materialModified.Dispatch<EventMaterialModified>([&](EventMaterialModified& e) {
-		if(materials.count(e.name)) {
-			for(auto [key, i] : materials.at(e.name)) {
-				i->getParameter("u_diffuseColor")->setValue(e.color);
-				i->getParameter("u_ambientColor")->setValue(e.ambientColor);
-
-				std::string filePath(e.textureFilePath);
-				if(!filePath.empty())
-					i->getParameter("u_diffuseTexture")->setValue(filePath.c_str(), true);
-				else
-					i->getParameter("u_diffuseTexture")->setValue("resource/DefaultTexture.png", true);
-
-				filePath = e.normalFilePath;
-				if(!filePath.empty())
-					i->getParameter("u_normalmapTexture")->setValue(filePath.c_str(), true);
-				else
-					i->getParameter("u_normalmapTexture")->setValue("resource/DefaultNormal.png", true);
-			}
-		}
+		uploads.UpdateMaterial(e);
+
+		if(shaders.count(e.shader))
+			shaders.at(e.shader).Set(e.color, e.ambientColor, e.textureFilePath, e.normalFilePath);
 	});
 
 	EventDispatcher materialChanged(event);
 	materialChanged.Dispatch<EventMaterialChanged>([&](EventMaterialChanged& e) {
+		uploads.ChangeMaterial(e);
+
 		Material* material(nullptr);
 
-		for(auto& [key, i] : materials)
-			if(i.count(e.meshName)) {
-				material = i.at(e.meshName);
-				i.erase(e.meshName);
+		for(auto& [key, i] : shaders)
+			if(i.meshes.count(e.mesh)) {
+				material = i.meshes.at(e.mesh);
+				i.meshes.erase(e.mesh);
 				break;
 			}
 
 		if(material) {
-			material->getParameter("u_diffuseColor")->setValue(e.color);
-			material->getParameter("u_ambientColor")->setValue(e.ambientColor);
-
-			std::string filePath(e.textureFilePath);
-			if(!filePath.empty())
-				material->getParameter("u_diffuseTexture")->setValue(filePath.c_str(), true);
-			else
-				material->getParameter("u_diffuseTexture")->setValue("resource/DefaultTexture.png", true);
-
-			filePath = e.normalFilePath;
-			if(!filePath.empty())
-				material->getParameter("u_normalmapTexture")->setValue(filePath.c_str(), true);
-			else
-				material->getParameter("u_normalmapTexture")->setValue("resource/DefaultNormal.png", true);
-
-			if(!materials.count(e.newName))
-				materials.emplace(e.newName, std::map<std::string, Material*>());
-
-			materials.at(e.newName).emplace(e.meshName, material);
+			ShaderParameters& shader = GetShader(e.shader, e);
+			shader.Bind(material);
+			shader.meshes.emplace(e.mesh, material);
 		}
 	});
 
 	EventDispatcher vertexModified(event);
 	vertexModified.Dispatch<EventVertexModified>([&](EventVertexModified& e) {
-		Node* node = _scene->findNode(e.name);
+		uploads.Complete(e.handle);
+		EventBuffer* payload = receiver.Payload();
+		Node* node = FindNode(e.handle);
 
 		if(node) {
 			Drawable* drawable = node->getDrawable();
@@ -252,53 +301,94 @@ void MayaViewer::EventCallback(Event* event) {
 			Mesh* mesh = model->getMesh();
 
 			if(mesh->getVertexCount() == e.vertexCount) {
-				Vertex* vertecies = NEW Vertex[e.vertexCount];
-				memcpy(vertecies, &e + 1ull, sizeof(Vertex) * e.vertexCount);
-				mesh->setVertexData(vertecies);
-				delete[] vertecies;
+				if(!e.rangeCount) {
+					mesh->setVertexData(&e + 1ull);
+					SetPositionBounds(model->getMaterial(), e.layout);
+					SetMeshBounds(mesh, payload->box, payload->sphere);
+				}
+				else {
+					VertexRange* ranges = (VertexRange*)(&e + 1ull);
+					char* vertecies = (char*)(ranges + e.rangeCount);
+
+					for(uint32_t i = 0u; i < e.rangeCount; i++) {
+						mesh->setVertexData(vertecies, ranges[i].start, ranges[i].count);
+						vertecies += e.layout.VertexSize() * ranges[i].count;
+					}
+
+					// Without sent bounds only the edited vertices are known, so the bounds only grow.
+					if(e.bounds.radius >= 0.f)
+						SetMeshBounds(mesh, payload->box, payload->sphere);
+					else {
+						BoundingBox box(mesh->getBoundingBox());
+						if(payload->editBounds) box.merge(payload->box);
+						BoundingSphere sphere;
+						sphere.set(box);
+						SetMeshBounds(mesh, box, sphere);
+					}
+				}
+				node->setBoundsDirty();
 			}
 		}
 	});
 
 	EventDispatcher topologyModified(event);
 	topologyModified.Dispatch<EventTopologyModified>([&](EventTopologyModified& e) {
-		Node* node = _scene->findNode(e.name);
+		uploads.Complete(e.handle);
+		EventBuffer* payload = receiver.Payload();
+		Node* node = FindNode(e.handle);
 
 		if(node) {
 			Drawable* drawable = node->getDrawable();
 			Model* model = static_cast<Model*>(drawable);
 			Mesh* mesh = model->getMesh();
 
-			if(mesh->getVertexCount() != e.vertexCount) {
-				Vertex* vertecies = NEW Vertex[e.vertexCount];
-				memcpy(vertecies, &e + 1ull, sizeof(Vertex) * e.vertexCount);
-
-				Mesh* newMesh = CreateMesh(vertecies, e.vertexCount);
+			Material* material = model->getMaterial();
+			char* vertecies = (char*)(&e + 1ull);
+			char* indices = vertecies + e.layout.VertexSize() * e.vertexCount;
+			MeshPart* part = mesh->getPartCount() ? mesh->getPart(0u) : nullptr;
+			Mesh::IndexFormat indexFormat = (e.indexSize == 2u) ? Mesh::INDEX16 : Mesh::INDEX32;
+
+			// Same sized buffers are refilled, otherwise the mesh is replaced.
+			if(part && mesh->getVertexCount() == e.vertexCount && part->getIndexCount() == e.indexCount && part->getIndexFormat() == indexFormat) {
+				mesh->setVertexData(vertecies, 0, e.vertexCount);
+				part->setIndexData(indices, 0, e.indexCount);
+				SetMeshBounds(mesh, payload->box, payload->sphere);
+				node->setBoundsDirty();
+			}
+			else {
+				Mesh* newMesh = CreateMesh(e.layout, vertecies, e.vertexCount, e.indexCount, e.indexSize);
+				SetMeshBounds(newMesh, payload->box, payload->sphere);
 				Model* newModel = Model::create(newMesh);
-				newModel->setMaterial(model->getMaterial());
+				newModel->setMaterial(material);
 				node->setDrawable(newModel);
-
-				delete[] vertecies;
+				SAFE_RELEASE(newModel);
+				SAFE_RELEASE(newMesh);
 			}
+
+			SetPositionBounds(material, e.layout);
 		}
 	});
-
-	char* memory = (char*)event;
-	delete[] memory;
 }
 
 void MayaViewer::update(float elapsedTime) {
 
-	bool done(false);
-	while(!done) {
-		Event* event(nullptr);
-		done = !com.Inject((void**)&event);
-		if(event) EventCallback(event);
+	// Events received since the last frame are applied until the budget is used up, at least one per frame.
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(Event* event = receiver.Next()) {
+		EventCallback(event);
+		receiver.Pop();
+
+		if(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= _eventBudget)
+			break;
 	}
 
-	for(auto& [key, i] : materials) {
-		if(i.size() == 0ull) {
-			materials.erase(key);
+	// World matrices of moved nodes in one pass, before the uploads measure camera distances.
+	_scene->updateTransforms();
+	uploads.Update(_scene->getActiveCamera(), _uploadBudget);
+
+	for(auto& [key, i] : shaders) {
+		if(i.meshes.size() == 0ull) {
+			shaders.erase(key);
 			break;
 		}
 	}
@@ -307,13 +397,32 @@ void MayaViewer::update(float elapsedTime) {
 void MayaViewer::render(float elapsedTime) {
     clear(CLEAR_COLOR_DEPTH, Vector4(0.35f, 0.35f, 0.35f, 0.1f), 1.0f, 0);
 
+    _visibleCount = 0u;
+    _culledCount = 0u;
     _scene->visit(this, &MayaViewer::drawScene);
+
+    if (_statsFont) {
+        char text[64];
+        snprintf(text, sizeof(text), "%u drawn, %u culled", _visibleCount, _culledCount);
+        _statsFont->start();
+        _statsFont->drawText(text, 5, 5, Vector4::one(), _statsFont->getSize());
+        _statsFont->finish();
+    }
 }
 
 bool MayaViewer::drawScene(Node* node) {
     Drawable* drawable = node->getDrawable(); 
-    if (drawable)
-        drawable->draw();
+    if (drawable) {
+        // Nodes whose world bounds are outside the camera's view aren't drawn.
+        Camera* camera = _scene->getActiveCamera();
+        if (camera && !node->getBoundingSphere().intersects(camera->getFrustum())) {
+            _culledCount++;
+        }
+        else {
+            drawable->draw();
+            _visibleCount++;
+        }
+    }
 
     return true;
 }
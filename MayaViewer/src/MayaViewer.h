@@ -56,11 +56,16 @@ protected:
 private:
 
     /**
-     * Draws the scene each frame.
+     * Draws the scene each frame, skipping nodes outside the camera frustum.
      */
     bool drawScene(Node* node);
 
     Scene* _scene;
+    float _eventBudget;
+    float _uploadBudget;
+    Font* _statsFont;
+    unsigned int _visibleCount;
+    unsigned int _culledCount;
 };
 
 #endif
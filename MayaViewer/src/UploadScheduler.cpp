@@ -0,0 +1,261 @@
+#include "UploadScheduler.h"
+#include<chrono>
+#include<limits>
+
+
+// Vertices written to a vertex buffer per step.
+const uint32_t stepVertices(32768u);
+
+VertexFormat GetVertexFormat(const VertexLayout& layout) {
+	switch(layout.encoding) {
+		case VertexEncoding::Packed: {
+			VertexFormat::Element elements[] = {
+				VertexFormat::Element(VertexFormat::POSITION, 4),
+				VertexFormat::Element(VertexFormat::NORMAL, 2, VertexFormat::SHORT, true),
+				VertexFormat::Element(VertexFormat::TANGENT, 2, VertexFormat::SHORT, true),
+				VertexFormat::Element(VertexFormat::TEXCOORD0, 2, VertexFormat::HALF_FLOAT)
+			};
+			return VertexFormat(elements, 4);
+		}
+		case VertexEncoding::Quantized: {
+			VertexFormat::Element elements[] = {
+				VertexFormat::Element(VertexFormat::POSITION, 4, VertexFormat::UNSIGNED_SHORT, true),
+				VertexFormat::Element(VertexFormat::NORMAL, 2, VertexFormat::SHORT, true),
+				VertexFormat::Element(VertexFormat::TANGENT, 2, VertexFormat::SHORT, true),
+				VertexFormat::Element(VertexFormat::TEXCOORD0, 2, VertexFormat::HALF_FLOAT)
+			};
+			return VertexFormat(elements, 4);
+		}
+		default: {
+			VertexFormat::Element elements[] = {
+				VertexFormat::Element(VertexFormat::POSITION, 3),
+				VertexFormat::Element(VertexFormat::NORMAL, 3),
+				VertexFormat::Element(VertexFormat::TANGENT, 3),
+				VertexFormat::Element(VertexFormat::BINORMAL, 3),
+				VertexFormat::Element(VertexFormat::TEXCOORD0, 2)
+			};
+			return VertexFormat(elements, 5);
+		}
+	}
+}
+
+// Float and packed vertices start with a float position, quantized ones fill their bounds.
+BoundingBox GetPositionBounds(const VertexLayout& layout, const void* vertices, uint32_t vertexCount) {
+	if(layout.encoding == VertexEncoding::Quantized)
+		return BoundingBox(layout.positionOffset, layout.positionOffset + layout.positionScale);
+
+	if(!vertexCount)
+		return BoundingBox();
+
+	const char* vertex = (const char*)vertices;
+#ifdef GP_USE_SSE
+	// A whole lane of four is read, the fourth float is the next attribute or the packed binormal sign.
+	__m128 min = _mm_loadu_ps((const float*)vertex);
+	__m128 max = min;
+	for(uint32_t i = 1u; i < vertexCount; i++) {
+		vertex += layout.VertexSize();
+		__m128 position = _mm_loadu_ps((const float*)vertex);
+		min = _mm_min_ps(min, position);
+		max = _mm_max_ps(max, position);
+	}
+
+	float lanes[2][4];
+	_mm_storeu_ps(lanes[0], min);
+	_mm_storeu_ps(lanes[1], max);
+	return BoundingBox(Vector3(lanes[0]), Vector3(lanes[1]));
+#else
+	Vector3 min((const float*)vertex);
+	Vector3 max(min);
+	for(uint32_t i = 1u; i < vertexCount; i++) {
+		vertex += layout.VertexSize();
+		const float* position = (const float*)vertex;
+		min.set(std::min(min.x, position[0]), std::min(min.y, position[1]), std::min(min.z, position[2]));
+		max.set(std::max(max.x, position[0]), std::max(max.y, position[1]), std::max(max.z, position[2]));
+	}
+
+	return BoundingBox(min, max);
+#endif
+}
+
+void GetMeshBounds(const MeshBounds& sent, const VertexLayout& layout, const void* vertices, uint32_t vertexCount,
+	BoundingBox& box, BoundingSphere& sphere) {
+
+	if(sent.radius >= 0.f) {
+		box.set(sent.min, sent.max);
+		sphere.set(sent.center, sent.radius);
+	}
+	else {
+		box = GetPositionBounds(layout, vertices, vertexCount);
+		sphere.set(box);
+	}
+}
+
+void SetMeshBounds(Mesh* mesh, const BoundingBox& box, const BoundingSphere& sphere) {
+	mesh->setBoundingBox(box);
+	mesh->setBoundingSphere(sphere);
+}
+
+
+UploadScheduler::UploadScheduler() {
+}
+
+UploadScheduler::~UploadScheduler() {
+	Clear();
+}
+
+void UploadScheduler::Add(EventBuffer* buffer, Node* node) {
+	EventMeshCreated* e = (EventMeshCreated*)buffer->GetEvent();
+	Cancel(e->handle);
+
+	Upload& upload = m_pending[e->handle];
+	upload.node = node;
+	upload.buffer = buffer;
+	upload.mesh = nullptr;
+	upload.uploadedVertices = 0u;
+
+	SetPlaceholder(upload);
+}
+
+void UploadScheduler::Complete(ObjectHandle handle) {
+	auto upload = m_pending.find(handle);
+	if(upload == m_pending.end()) return;
+
+	while(!Step(upload->second));
+	Release(upload->second);
+	m_pending.erase(upload);
+}
+
+void UploadScheduler::Cancel(ObjectHandle handle) {
+	auto upload = m_pending.find(handle);
+	if(upload == m_pending.end()) return;
+
+	Release(upload->second);
+	m_pending.erase(upload);
+}
+
+void UploadScheduler::UpdateMaterial(EventMaterialModified& e) {
+	for(auto& [handle, upload] : m_pending) {
+		EventMeshCreated* mesh = upload.GetEvent();
+		if(mesh->shader != e.shader) continue;
+
+		memcpy(mesh->textureFilePath, e.textureFilePath, sizeof(e.textureFilePath));
+		memcpy(mesh->normalFilePath, e.normalFilePath, sizeof(e.normalFilePath));
+		mesh->color = e.color;
+		mesh->ambientColor = e.ambientColor;
+	}
+}
+
+void UploadScheduler::ChangeMaterial(EventMaterialChanged& e) {
+	auto upload = m_pending.find(e.mesh);
+	if(upload == m_pending.end()) return;
+
+	EventMeshCreated* mesh = upload->second.GetEvent();
+	mesh->shader = e.shader;
+	memcpy(mesh->textureFilePath, e.textureFilePath, sizeof(e.textureFilePath));
+	memcpy(mesh->normalFilePath, e.normalFilePath, sizeof(e.normalFilePath));
+	mesh->color = e.color;
+	mesh->ambientColor = e.ambientColor;
+}
+
+// The nearest mesh is picked again each time one is done, so a scan per mesh and not per step.
+void UploadScheduler::Update(Camera* camera, float budgetMs) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	Vector3 eye;
+	if(camera && camera->getNode())
+		eye = camera->getNode()->getTranslationWorld();
+
+	while(!m_pending.empty()) {
+		auto nearest = m_pending.end();
+		float nearestDistance = std::numeric_limits<float>::max();
+		for(auto upload = m_pending.begin(); upload != m_pending.end(); upload++) {
+			Vector3 center = upload->second.buffer->sphere.center;
+			upload->second.node->getWorldMatrix().transformPoint(&center);
+
+			float distance = center.distanceSquared(eye);
+			if(distance < nearestDistance || nearest == m_pending.end()) {
+				nearest = upload;
+				nearestDistance = distance;
+			}
+		}
+
+		bool done(false);
+		while(!done) {
+			done = Step(nearest->second);
+			if(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+				break;
+		}
+
+		if(!done)
+			return;
+
+		Release(nearest->second);
+		m_pending.erase(nearest);
+	}
+}
+
+void UploadScheduler::Clear() {
+	for(auto& [handle, upload] : m_pending)
+		Release(upload);
+	m_pending.clear();
+}
+
+// Creates the mesh, fills its vertex buffer a piece at a time, then its index buffer, then hands it on.
+bool UploadScheduler::Step(Upload& upload) {
+	EventMeshCreated* e = upload.GetEvent();
+	const char* vertices = (const char*)(e + 1);
+
+	if(!upload.mesh) {
+		upload.mesh = Mesh::createMesh(GetVertexFormat(e->layout), e->vertexCount, true);
+		if(upload.mesh == nullptr) {
+			GP_ERROR("Failed to create mesh.");
+			return true;
+		}
+		SetMeshBounds(upload.mesh, upload.buffer->box, upload.buffer->sphere);
+		return false;
+	}
+
+	if(upload.uploadedVertices < e->vertexCount) {
+		uint32_t count = std::min(stepVertices, e->vertexCount - upload.uploadedVertices);
+		upload.mesh->setVertexData(vertices + e->layout.VertexSize() * upload.uploadedVertices, upload.uploadedVertices, count);
+		upload.uploadedVertices += count;
+		return false;
+	}
+
+	if(!upload.mesh->getPartCount()) {
+		Mesh::IndexFormat indexFormat = (e->indexSize == 2u) ? Mesh::INDEX16 : Mesh::INDEX32;
+		MeshPart* part = upload.mesh->addPart(Mesh::TRIANGLES, indexFormat, e->indexCount, true);
+		part->setIndexData(vertices + e->layout.VertexSize() * e->vertexCount, 0, e->indexCount);
+		return false;
+	}
+
+	if(m_finish)
+		m_finish(upload.node, upload.mesh, *e);
+	SAFE_RELEASE(upload.mesh);
+	return true;
+}
+
+// An unlit box of the mesh bounds.
+void UploadScheduler::SetPlaceholder(Upload& upload) {
+	Mesh* mesh = Mesh::createBoundingBox(upload.buffer->box);
+	if(mesh == nullptr) return;
+	SetMeshBounds(mesh, upload.buffer->box, upload.buffer->sphere);
+
+	Model* model = Model::create(mesh);
+	Material* material = model->setMaterial("resource/shaders/colored.vert", "resource/shaders/colored.frag");
+	material->setParameterAutoBinding("u_worldViewProjectionMatrix", "WORLD_VIEW_PROJECTION_MATRIX");
+	material->getParameter("u_diffuseColor")->setValue(Vector4(0.8f, 0.8f, 0.8f, 1.f));
+	material->getStateBlock()->setDepthTest(true);
+
+	upload.node->setDrawable(model);
+	SAFE_RELEASE(model);
+	SAFE_RELEASE(mesh);
+}
+
+// Drops a mesh still being uploaded and hands the event buffer back.
+void UploadScheduler::Release(Upload& upload) {
+	SAFE_RELEASE(upload.mesh);
+	if(m_recycle)
+		m_recycle(upload.buffer);
+	upload.buffer = nullptr;
+}
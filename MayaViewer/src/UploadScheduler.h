@@ -0,0 +1,74 @@
+#pragma once
+#include"gameplay.h"
+#include"EventHandler.h"
+#include"EventReceiver.h"
+#include<functional>
+#include<unordered_map>
+#include<vector>
+
+using namespace gameplay;
+
+VertexFormat GetVertexFormat(const VertexLayout& layout);
+
+// Bounds of the positions in a vertex buffer encoded as in layout.
+BoundingBox GetPositionBounds(const VertexLayout& layout, const void* vertices, uint32_t vertexCount);
+
+// The bounds sent with a mesh, or the box of its vertices and the sphere around it when none were sent.
+void GetMeshBounds(const MeshBounds& sent, const VertexLayout& layout, const void* vertices, uint32_t vertexCount,
+	BoundingBox& box, BoundingSphere& sphere);
+
+// Nodes are culled by the sphere.
+void SetMeshBounds(Mesh* mesh, const BoundingBox& box, const BoundingSphere& sphere);
+
+// Spreads the GPU work of new meshes over frames. A mesh shows as a box of its bounds until
+// its buffers are filled, a few thousand vertices at a time, and Finish has made its model.
+// Meshes nearest the active camera go first.
+class UploadScheduler {
+	public:
+	using FinishFunc = std::function<void(Node*, Mesh*, EventMeshCreated&)>;
+	using RecycleFunc = std::function<void(EventBuffer*)>;
+
+	UploadScheduler();
+	~UploadScheduler();
+
+	// finish makes the model and material once the mesh is uploaded and puts it on the node.
+	void SetFinish(const FinishFunc& finish) {m_finish = finish;}
+	// recycle gets the buffer of every mesh that is done or dropped.
+	void SetRecycle(const RecycleFunc& recycle) {m_recycle = recycle;}
+
+	// Keeps the buffer of an EventMeshCreated, the node shows a placeholder until the upload is done.
+	void Add(EventBuffer* buffer, Node* node);
+	bool IsPending(ObjectHandle handle) {return m_pending.count(handle) != 0ull;}
+
+	// Uploads the rest of a mesh right away, for events that need it complete.
+	void Complete(ObjectHandle handle);
+	void Cancel(ObjectHandle handle);
+
+	// Keeps pending meshes in step with material events sent before they were made.
+	void UpdateMaterial(EventMaterialModified& e);
+	void ChangeMaterial(EventMaterialChanged& e);
+
+	// Uploads for up to budgetMs milliseconds, at least one step per frame.
+	void Update(Camera* camera, float budgetMs);
+
+	void Clear();
+
+	private:
+	struct Upload {
+		Node* node;
+		EventBuffer* buffer;
+		Mesh* mesh;
+		uint32_t uploadedVertices;
+
+		EventMeshCreated* GetEvent() {return (EventMeshCreated*)buffer->data.data();}
+	};
+
+	// One piece of work, returns true once the mesh is done.
+	bool Step(Upload& upload);
+	void SetPlaceholder(Upload& upload);
+	void Release(Upload& upload);
+
+	std::unordered_map<ObjectHandle, Upload> m_pending;
+	FinishFunc m_finish;
+	RecycleFunc m_recycle;
+};
@@ -1,19 +1,38 @@
 #include "Comlib.h"
 
-Comlib::Comlib(LPCWSTR bufferName, size_t bufferSize, ProcessType type)
-    :mp_mutex(nullptr), mp_sharedMemory(nullptr), mp_messageData(nullptr), mp_head(nullptr), mp_tail(nullptr), mp_freeMemory(nullptr),
-    mp_messageHeader(nullptr), mp_ctrler(nullptr), m_type(type) {
+// Lock free records are padded so every header starts aligned and always fits before the end of the buffer.
+static size_t RecordSize(size_t messageLength) {
+    const size_t align = sizeof(MessageHeader);
+    return (messageLength + sizeof(MessageHeader) + align - 1ull) & ~(align - 1ull);
+}
+
+// Space a batch asks for up front, it is shrunk to what was written when flushed.
+static const size_t batchCapacity(64ull * 1024ull);
+
+Comlib::Comlib(LPCWSTR bufferName, size_t bufferSize, ProcessType type, RingMode mode)
+    :mp_mutex(nullptr), mp_doorbell(nullptr), mp_sharedMemory(nullptr), mp_messageData(nullptr), mp_head(nullptr), mp_tail(nullptr), mp_freeMemory(nullptr),
+    mp_messageHeader(nullptr), mp_ctrler(nullptr), mp_reserved(nullptr), mp_peeked(nullptr), m_peekTail(0ull),
+    m_streamOffset(0ull), m_streamSequence(0u), m_batchLength(0ull), m_peekBatchOffset(0ull), m_batching(false), m_assembly(), m_assembled(0ull), m_assemblySequence(0u), m_assemblyReady(false), m_type(type), m_mode(mode) {
 
     std::wstring ctrBName(bufferName);
     ctrBName += +L"_ctrBuffer";
     mp_sharedMemory = NEW Memory(bufferName, ctrBName.c_str(), bufferSize);
     mp_messageData = mp_sharedMemory->GetMemoryBuffer();
-    mp_mutex = NEW Mutex(L"MutexMap");
+    if(mode == RingMode::Locked) {
+        std::wstring mutexName(bufferName);
+        mutexName += L"_mutex";
+        mp_mutex = NEW Mutex(mutexName.c_str());
+    }
+
 
+    mp_ctrler = mp_sharedMemory->GetControlBuffer();
+    mp_head = &mp_ctrler->head;
+    mp_tail = &mp_ctrler->tail;
+    mp_freeMemory = &mp_ctrler->freeMemory;
 
-    mp_head = mp_sharedMemory->GetControlBuffer();
-    mp_tail = mp_head + 1;
-    mp_freeMemory = mp_tail + 1;
+    std::wstring doorbellName(bufferName);
+    doorbellName += L"_doorbell";
+    mp_doorbell = NEW Doorbell(doorbellName.c_str(), &mp_ctrler->doorbell, &mp_ctrler->sleeping);
 
     if(type == ProcessType::Producer) {
         Print("Producer Initialized.\n");
@@ -31,111 +50,340 @@ Comlib::Comlib(LPCWSTR bufferName, size_t bufferSize, ProcessType type)
 }
 
 Comlib::~Comlib() {
+    delete mp_doorbell;
     delete mp_sharedMemory;
     delete mp_mutex;
 }
 
 bool Comlib::Send(void* message, MessageHeader* msgHeader) {
 
-    mp_mutex->Lock();
+    return SendRecord(message, msgHeader);
+}
+
+bool Comlib::Recieve(void* message) {
+
+    size_t tail(0ull);
+    mp_messageHeader = NextRecord(tail);
+    if(!mp_messageHeader) return false;
 
-    size_t memoryLeft = mp_sharedMemory->GetBufferSize() - *mp_head;
-    if(msgHeader->messageLength + sizeof(MessageHeader) >= memoryLeft) {
+    memcpy(message, mp_messageHeader + 1, mp_messageHeader->messageLength);
+    SetTail(tail + RecordSize(mp_messageHeader->messageLength));
+    return true;
+}
+
+bool Comlib::Inject(void** message) {
 
-        if(*mp_tail != 0ull) {
-            msgHeader->messageID = 0ull;
-            memcpy(mp_messageData + *mp_head, msgHeader, sizeof(MessageHeader));
+    if(*message) return false;
 
-            *mp_freeMemory -= (msgHeader->messageLength + sizeof(MessageHeader));
-            *mp_head = 0ull;
+    size_t tail(0ull);
+    mp_messageHeader = NextRecord(tail);
+    if(!mp_messageHeader) return false;
 
+    *message = NEW char[mp_messageHeader->messageLength];
+    memcpy(*message, mp_messageHeader + 1, mp_messageHeader->messageLength);
+    SetTail(tail + RecordSize(mp_messageHeader->messageLength));
+    return true;
+}
+
+// Only the Producer writes head and only the Consumer writes tail, so the ring needs no lock.
+// Head is published with release after the record is written, tail after it has been read.
+// Locked mode uses the same records and also holds the mutex from Reserve to Commit and while tail moves.
+bool Comlib::SendRecord(void* message, MessageHeader* msgHeader) {
+
+    void* data = Reserve(msgHeader->messageLength);
+    if(!data) return false;
+
+    memcpy(data, message, msgHeader->messageLength);
+    Commit();
+    return true;
+}
+
+// Returns the next message header, or nullptr if the ring is empty. Skips the wrap marker.
+MessageHeader* Comlib::NextRecord(size_t& tail) {
+
+    tail = mp_tail->load(std::memory_order_relaxed);
+    size_t head = mp_head->load(std::memory_order_acquire);
+    if(tail == head) return nullptr;
+
+    MessageHeader* msgHeader = (MessageHeader*)&mp_messageData[tail];
+    if(msgHeader->messageID == 0ull) {
+        tail = 0ull;
+        msgHeader = (MessageHeader*)mp_messageData;
+    }
+
+    return msgHeader;
+}
+
+void Comlib::SetTail(size_t tail) {
+
+    if(mp_mutex) mp_mutex->Lock();
+    mp_tail->store(tail, std::memory_order_release);
+    if(mp_mutex) mp_mutex->Unlock();
+}
+
+// Reserves between minLength and messageLength bytes, as much as fits in one contiguous piece.
+void* Comlib::ReserveRecord(size_t minLength, size_t& messageLength, size_t messageID) {
+
+    if(mp_reserved) return nullptr;
+    if(mp_mutex) mp_mutex->Lock();
+
+    const size_t bufferSize = mp_sharedMemory->GetBufferSize() & ~(sizeof(MessageHeader) - 1ull);
+    size_t head = mp_head->load(std::memory_order_relaxed);
+    size_t tail = mp_tail->load(std::memory_order_acquire);
+
+    // The ring is empty when head == tail, so a record may never fill it up to tail.
+    // A record fits in space when RecordSize(length) < space, or length <= space - 2 headers.
+    const size_t overhead = sizeof(MessageHeader) * 2ull;
+    size_t writePos = head;
+    size_t space = (head >= tail) ? bufferSize - head : tail - head;
+    if(space < overhead || space - overhead < minLength) {
+        if(head < tail || tail < overhead || tail - overhead < minLength) {
+            if(mp_mutex) mp_mutex->Unlock();
+            return nullptr;
         }
 
-    } else if(msgHeader->messageLength + sizeof(MessageHeader) < *mp_freeMemory - 1ull) {
-        msgHeader->messageID = 1ull;
+        // Not published until Commit moves head, the Consumer can't see it before that.
+        MessageHeader wrap;
+        wrap.messageID = 0ull;
+        wrap.messageLength = 0ull;
+        memcpy(mp_messageData + head, &wrap, sizeof(MessageHeader));
+        writePos = 0ull;
+        space = tail;
+    }
+
+    messageLength = std::min<size_t>(messageLength, space - overhead);
+
+    mp_reserved = (MessageHeader*)(mp_messageData + writePos);
+    mp_reserved->messageID = messageID;
+    mp_reserved->messageLength = messageLength;
+    return mp_reserved + 1;
+}
+
+void* Comlib::Reserve(size_t messageLength) {
+
+    FlushBatch();
+    return ReserveRecord(messageLength, messageLength, 1ull);
+}
+
+void Comlib::Commit() {
+
+    if(!mp_reserved) return;
+
+    size_t writePos = (char*)mp_reserved - mp_messageData;
+    mp_head->store(writePos + RecordSize(mp_reserved->messageLength), std::memory_order_release);
+    mp_reserved = nullptr;
+    if(mp_mutex) mp_mutex->Unlock();
+    mp_doorbell->Ring();
+}
+
+void Comlib::Commit(size_t messageLength) {
+
+    if(mp_reserved && messageLength < mp_reserved->messageLength)
+        mp_reserved->messageLength = messageLength;
+
+    Commit();
+}
+
+size_t Comlib::GetMaxMessageLength() {
+
+    return (mp_sharedMemory->GetBufferSize() / 4ull) & ~(sizeof(MessageHeader) - 1ull);
+}
 
-        memcpy(mp_messageData + *mp_head, msgHeader, sizeof(MessageHeader));
-        memcpy(mp_messageData + *mp_head + sizeof(MessageHeader), message, msgHeader->messageLength);
+// Small messages go whole, larger ones are cut into fragments that fill the free space up to
+// the end of the buffer, so no space is lost to the wrap marker.
+bool Comlib::SendStream(const void* message, size_t messageLength) {
 
-        *mp_freeMemory -= (msgHeader->messageLength + sizeof(MessageHeader));
-        *mp_head = (*mp_head + msgHeader->messageLength + sizeof(MessageHeader)) % mp_sharedMemory->GetBufferSize();
+    FlushBatch();
+    if(messageLength <= GetMaxMessageLength()) {
+        void* data = Reserve(messageLength);
+        if(!data) return false;
 
-        mp_mutex->Unlock();
+        memcpy(data, message, messageLength);
+        Commit();
         return true;
+    }
+
+    const size_t maxFragment = GetMaxMessageLength() - sizeof(FragmentHeader);
+    while(m_streamOffset < messageLength) {
+        size_t remaining = messageLength - m_streamOffset;
+        size_t fragmentLength = std::min<size_t>(remaining, maxFragment) + sizeof(FragmentHeader);
+        size_t minLength = std::min<size_t>(remaining, maxFragment / 8ull) + sizeof(FragmentHeader);
+
+        FragmentHeader* fragment = (FragmentHeader*)ReserveRecord(minLength, fragmentLength, 2ull);
+        if(!fragment) return false;
 
+        size_t dataLength = fragmentLength - sizeof(FragmentHeader);
+        fragment->totalLength = messageLength;
+        fragment->offset = m_streamOffset;
+        fragment->sequence = m_streamSequence++;
+        fragment->padding = 0u;
+        memcpy(fragment + 1, (const char*)message + m_streamOffset, dataLength);
+        Commit();
+
+        m_streamOffset += dataLength;
     }
 
-    mp_mutex->Unlock();
-    return false;
+    AbortStream();
+    return true;
 }
 
-bool Comlib::Recieve(void* message) {
+void Comlib::AbortStream() {
+
+    m_streamOffset = 0ull;
+    m_streamSequence = 0u;
+}
+
+// The batch stays reserved while it fills, so a burst of messages costs one record and one doorbell.
+bool Comlib::SendBatched(const void* message, size_t messageLength) {
+
+    // The mutex can't stay held while a batch fills, so Locked mode sends every message on its own.
+    size_t entryLength = RecordSize(messageLength);
+    if(mp_mutex || entryLength > GetMaxMessageLength() / 2ull)
+        return SendStream(message, messageLength);
+
+    if(m_batching && m_batchLength + entryLength > mp_reserved->messageLength)
+        FlushBatch();
+
+    if(!m_batching) {
+        size_t length = std::min<size_t>(batchCapacity, GetMaxMessageLength());
+        if(!ReserveRecord(entryLength, length, 3ull)) return false;
 
-    mp_mutex->Lock();
+        m_batching = true;
+        m_batchLength = 0ull;
+    }
+
+    MessageHeader* entry = (MessageHeader*)((char*)(mp_reserved + 1) + m_batchLength);
+    entry->messageID = 1ull;
+    entry->messageLength = messageLength;
+    memcpy(entry + 1, message, messageLength);
+    m_batchLength += entryLength;
+    return true;
+}
 
-    size_t msgLength(0ull);
-    if(*mp_freeMemory < mp_sharedMemory->GetBufferSize()) {
+void Comlib::FlushBatch() {
 
-        if(*mp_head != *mp_tail) {
-            mp_messageHeader = (MessageHeader*)&mp_messageData[*mp_tail];
+    if(!m_batching) return;
 
-            msgLength = mp_messageHeader->messageLength;
-            if(mp_messageHeader->messageID == 0ull) {
-                *mp_freeMemory += (msgLength + sizeof(MessageHeader));
-                *mp_tail = 0ull;
+    m_batching = false;
+    if(m_batchLength)
+        Commit(m_batchLength);
+    else {
+        mp_reserved = nullptr;
+        if(mp_mutex) mp_mutex->Unlock();
+    }
+}
 
-            } else {
-                memcpy(message, &mp_messageData[*mp_tail + sizeof(MessageHeader)], msgLength);
+// Fragments are copied into the assembly buffer and handed back to the Producer as they arrive,
+// so a message larger than the ring only needs the ring to keep moving.
+void* Comlib::Peek(size_t& messageLength) {
 
-                *mp_freeMemory += (msgLength + sizeof(MessageHeader));
-                *mp_tail = (*mp_tail + msgLength + sizeof(MessageHeader)) % mp_sharedMemory->GetBufferSize();
+    if(m_assemblyReady) {
+        messageLength = m_assembly.size();
+        return m_assembly.data();
+    }
 
-                mp_mutex->Unlock();
-                return true;
-                
+    while(!mp_peeked) {
+        MessageHeader* msgHeader = NextRecord(m_peekTail);
+        if(!msgHeader) return nullptr;
+
+        if(msgHeader->messageID != 2ull) {
+            if(m_assembled) {
+                Print("ERROR: Streamed message interrupted after {0} of {1} bytes.\n", m_assembled, m_assembly.size());
+                ClearAssembly();
             }
+
+            mp_peeked = msgHeader;
+            break;
+        }
+
+        FragmentHeader* fragment = (FragmentHeader*)(msgHeader + 1);
+        size_t dataLength = msgHeader->messageLength - sizeof(FragmentHeader);
+
+        if(fragment->offset == 0ull) {
+            if(m_assembled) Print("ERROR: Streamed message restarted after {0} of {1} bytes.\n", m_assembled, m_assembly.size());
+            m_assembly.resize(fragment->totalLength);
+            m_assembled = 0ull;
+            m_assemblySequence = 0u;
+        }
+
+        bool inSequence = fragment->sequence == m_assemblySequence && fragment->offset == m_assembled &&
+            fragment->totalLength == m_assembly.size() && dataLength <= m_assembly.size() - m_assembled;
+
+        if(inSequence) {
+            memcpy(m_assembly.data() + m_assembled, fragment + 1, dataLength);
+            m_assembled += dataLength;
+            m_assemblySequence++;
+        } else if(m_assembled) {
+            Print("ERROR: Fragment {0} out of sequence, dropping streamed message.\n", fragment->sequence);
+            ClearAssembly();
+        }
+
+        SetTail(m_peekTail + RecordSize(msgHeader->messageLength));
+
+        if(inSequence && m_assembled == m_assembly.size()) {
+            m_assemblyReady = true;
+            messageLength = m_assembly.size();
+            return m_assembly.data();
         }
     }
 
-    mp_mutex->Unlock();
-    return false;
+    // Messages of a batch are handed out one at a time in place.
+    if(mp_peeked->messageID == 3ull) {
+        MessageHeader* entry = (MessageHeader*)((char*)(mp_peeked + 1) + m_peekBatchOffset);
+        messageLength = entry->messageLength;
+        return entry + 1;
+    }
+
+    messageLength = mp_peeked->messageLength;
+    return mp_peeked + 1;
 }
 
-bool Comlib::Inject(void** message) {
+void Comlib::Release() {
+
+    if(m_assemblyReady) {
+        ClearAssembly();
+        return;
+    }
 
-    mp_mutex->Lock();
+    if(!mp_peeked) return;
 
-    size_t msgLength(0ull);
-    if(!*message) {
-        if(*mp_freeMemory < mp_sharedMemory->GetBufferSize()) {
+    if(mp_peeked->messageID == 3ull) {
+        MessageHeader* entry = (MessageHeader*)((char*)(mp_peeked + 1) + m_peekBatchOffset);
+        m_peekBatchOffset += RecordSize(entry->messageLength);
+        if(m_peekBatchOffset < mp_peeked->messageLength) return;
 
-            if(*mp_head != *mp_tail) {
-                mp_messageHeader = (MessageHeader*)&mp_messageData[*mp_tail];
+        m_peekBatchOffset = 0ull;
+    }
 
-                msgLength = mp_messageHeader->messageLength;
-                if(mp_messageHeader->messageID == 0ull) {
-                    *mp_freeMemory += (msgLength + sizeof(MessageHeader));
-                    *mp_tail = 0ull;
+    SetTail(m_peekTail + RecordSize(mp_peeked->messageLength));
+    mp_peeked = nullptr;
+}
 
-                } else {
-                    *message = NEW char[msgLength];
-                    memcpy(*message, &mp_messageData[*mp_tail + sizeof(MessageHeader)], msgLength);
+void Comlib::ClearAssembly() {
 
-                    *mp_freeMemory += (msgLength + sizeof(MessageHeader));
-                    *mp_tail = (*mp_tail + msgLength + sizeof(MessageHeader)) % mp_sharedMemory->GetBufferSize();
+    std::vector<char>().swap(m_assembly);
+    m_assembled = 0ull;
+    m_assemblySequence = 0u;
+    m_assemblyReady = false;
+}
 
-                    mp_mutex->Unlock();
-                    return true;
+bool Comlib::HasMessage() {
 
-                }
-            }
-        }
-    }
+    if(mp_peeked || m_assemblyReady) return true;
+    return mp_head->load(std::memory_order_acquire) != mp_tail->load(std::memory_order_relaxed);
+}
+
+bool Comlib::WaitForMessage(uint32_t timeoutMs) {
+
+    if(HasMessage()) return true;
 
-    mp_mutex->Unlock();
-    return false;
+    uint32_t ticket = mp_doorbell->Arm();
+    if(!HasMessage()) mp_doorbell->Wait(ticket, timeoutMs);
+    mp_doorbell->Disarm();
+
+    return HasMessage();
 }
 
 void Comlib::ClearMemory() {
-    ZeroMemory(&mp_messageData, mp_sharedMemory->GetBufferSize());
-}
+    memset(mp_messageData, 0, mp_sharedMemory->GetBufferSize());
+}
\ No newline at end of file
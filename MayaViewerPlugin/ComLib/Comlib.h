@@ -1,17 +1,29 @@
 #pragma once
 #include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 #include "Memory.h"
 #include "Headers.h"
 #include "Mutex.h"
+#include "Doorbell.h"
 
 enum class ProcessType {
 	Producer, 
 	Consumer
 };
 
+// Both modes lay out the ring the same way. LockFree relies on there being exactly one Producer
+// and one Consumer, Locked also holds a named mutex from Reserve to Commit and while the Consumer
+// moves tail. Both sides have to use the same mode.
+enum class RingMode {
+	Locked,
+	LockFree
+};
+
 class Comlib {
 	public:
-	Comlib(LPCWSTR bufferName, size_t bufferSize, ProcessType type);
+	Comlib(LPCWSTR bufferName, size_t bufferSize, ProcessType type, RingMode mode = RingMode::LockFree);
 	~Comlib();
 
 	Memory* GetSharedMemory() {return mp_sharedMemory;}
@@ -19,18 +31,77 @@ class Comlib {
 	bool Recieve(void* message);
 	bool Inject(void** message);
 
+	// Zero copy access to the ring.
+	// Reserve returns space for messageLength bytes to write in place, or nullptr if the ring is full.
+	// Nothing is visible to the Consumer until Commit, which may shrink the message to messageLength.
+	void* Reserve(size_t messageLength);
+	void Commit();
+	void Commit(size_t messageLength);
+
+	// Largest message Reserve can hand out, anything bigger has to go through SendStream.
+	size_t GetMaxMessageLength();
+
+	// Sends a message of any size, cutting it into fragments when it is larger than GetMaxMessageLength.
+	// Returns false when the ring is full, call again with the same message to continue where it stopped.
+	// AbortStream gives up on a partly sent message, the Consumer drops what it got of it.
+	bool SendStream(const void* message, size_t messageLength);
+	void AbortStream();
+	size_t GetStreamOffset() {return m_streamOffset;}
+
+	// Packs small messages back to back into one record that the Consumer reads with Peek,
+	// which still hands them out one at a time. Locked mode sends each message as its own record.
+	// Nothing is visible until FlushBatch, or until another message is sent or reserved or the batch is full.
+	// Returns false when the ring is full.
+	bool SendBatched(const void* message, size_t messageLength);
+	void FlushBatch();
+
+	// Peek returns the next message in place, or nullptr if there is none.
+	// Streamed messages are put back together as their fragments arrive and returned once complete.
+	// It stays valid and Peek keeps returning it until Release hands the space back to the Producer.
+	void* Peek(size_t& messageLength);
+	void Release();
+
+	// Sleeps until the Producer sends something or timeoutMs has passed, ~0u waits forever.
+	// Returns true if there is something to read, which for a streamed message may be just a fragment.
+	bool WaitForMessage(uint32_t timeoutMs);
+
 	void ClearMemory();
 
 	private:
+	bool SendRecord(void* message, MessageHeader* msgHeader);
+	MessageHeader* NextRecord(size_t& tail);
+	void SetTail(size_t tail);
+	void* ReserveRecord(size_t minLength, size_t& messageLength, size_t messageID);
+	void ClearAssembly();
+	bool HasMessage();
+
 	Mutex* mp_mutex;
+	Doorbell* mp_doorbell;
 	Memory* mp_sharedMemory;
 	char* mp_messageData;
 
-	size_t* mp_head;
-	size_t* mp_tail;
-	size_t* mp_freeMemory;
+	std::atomic<size_t>* mp_head;
+	std::atomic<size_t>* mp_tail;
+	std::atomic<size_t>* mp_freeMemory;
 
 	MessageHeader* mp_messageHeader;
 	ControlHeader* mp_ctrler;
+
+	MessageHeader* mp_reserved;
+	MessageHeader* mp_peeked;
+	size_t m_peekTail;
+
+	size_t m_streamOffset;
+	uint32_t m_streamSequence;
+
+	size_t m_batchLength;
+	size_t m_peekBatchOffset;
+	bool m_batching;
+
+	std::vector<char> m_assembly;
+	size_t m_assembled;
+	uint32_t m_assemblySequence;
+	bool m_assemblyReady;
 	const ProcessType m_type;
-};
\ No newline at end of file
+	const RingMode m_mode;
+};
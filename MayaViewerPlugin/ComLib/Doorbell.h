@@ -0,0 +1,34 @@
+#pragma once
+#include"CustomPrint.h"
+#include"Def.h"
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include <atomic>
+#include <cstdint>
+
+// Wakes a sleeping Consumer when the Producer publishes a message.
+// The ring count and sleeper flag live in the shared ControlHeader, Ring only
+// makes a syscall when the Consumer is actually asleep.
+class Doorbell {
+	public:
+	Doorbell(LPCWSTR doorbellName, std::atomic<uint32_t>* rings, std::atomic<uint32_t>* sleeping);
+	~Doorbell();
+
+	// Producer, after the message is published.
+	void Ring();
+
+	// Consumer, Arm before the last check for messages and Wait with the returned ticket if there were none.
+	// Wait returns when rung, after timeoutMs, or early, so check again after it. Disarm when done.
+	uint32_t Arm();
+	void Wait(uint32_t ticket, uint32_t timeoutMs);
+	void Disarm();
+
+	private:
+#ifdef _WIN32
+	HANDLE m_eventHandle;
+#endif
+	std::atomic<uint32_t>* mp_rings;
+	std::atomic<uint32_t>* mp_sleeping;
+
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include<atomic>
+#include<cstdint>
+
+#ifdef __linux__
+#include<linux/futex.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#include<ctime>
+#else
+#include<chrono>
+#include<thread>
+#endif
+
+// Process shared wait/wake on a 32-bit word that lives in shared memory.
+// No FUTEX_PRIVATE_FLAG, the word is mapped by more than one process.
+
+// Sleeps while *word == expected, until woken or timeoutMs has passed (~0u waits forever).
+// May return early, callers recheck their condition.
+inline void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t timeoutMs = ~0u) {
+#ifdef __linux__
+	timespec timeout;
+	timeout.tv_sec = timeoutMs / 1000u;
+	timeout.tv_nsec = (long)(timeoutMs % 1000u) * 1000000l;
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, (timeoutMs == ~0u) ? nullptr : &timeout, nullptr, 0);
+#else
+	if(word->load(std::memory_order_relaxed) == expected)
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs ? 1u : 0u));
+#endif
+}
+
+inline void FutexWake(std::atomic<uint32_t>* word, int count) {
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+#else
+	(void)word;
+	(void)count;
+#endif
+}
@@ -1,16 +1,38 @@
 #pragma once
 #include"CustomPrint.h"
+#include"Def.h"
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <string>
+#endif
 #include <iostream>
-#include"Def.h"
+#include <atomic>
+#include <cstdint>
 
 
+// Head and tail are written by different processes, keep them on separate cache lines.
 struct ControlHeader {
-	size_t head = 0ull;
-	size_t tail = 0ull;
-	size_t freeMemory = 0ull;
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+	alignas(64) std::atomic<size_t> freeMemory;
+	alignas(64) std::atomic<uint32_t> doorbell;
+	std::atomic<uint32_t> sleeping;
 };
 
+#ifndef _WIN32
+// shm_open wants "/name", the wide Comlib names are plain ASCII.
+inline std::string ToShmName(LPCWSTR name) {
+	std::string shmName("/");
+	for(; *name != L'\0'; name++)
+		shmName += static_cast<char>(*name);
+	return shmName;
+}
+
+// Opens or creates a named segment of at least size bytes, like CreateFileMapping does.
+int OpenSharedFile(const std::string& name, size_t size, bool& linked);
+#endif
+
 
 class Memory {
 	public:
@@ -18,17 +40,22 @@ class Memory {
 	~Memory();
 	
 	char* GetMemoryBuffer() {return mp_memoryData;}
-	size_t* GetControlBuffer() {return mp_controlData;}
+	ControlHeader* GetControlBuffer() {return mp_controlData;}
 
 	size_t GetControlBufferSize() {return m_controlbufferSize;}
 	size_t GetBufferSize() {return m_bufferSize;}
 
 	private:
+#ifdef _WIN32
 	HANDLE m_memoryFilemap;
 	HANDLE m_controlFilemap;
+#else
+	int m_memoryFilemap;
+	int m_controlFilemap;
+#endif
 
 	char* mp_memoryData;
-	size_t* mp_controlData;
+	ControlHeader* mp_controlData;
 
 	size_t m_bufferSize;
 	size_t m_controlbufferSize;
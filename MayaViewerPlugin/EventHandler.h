@@ -9,7 +9,6 @@ enum class EventType {
 	RefreshPlugin,
 	MeshCreated,
 	MeshDeleted,
-	NameChanged,
 	Transform,
 	MaterialModified,
 	MaterialChanged,
@@ -31,6 +30,9 @@ struct Event {
 
 inline Event::~Event() {}
 
+// Maya nodes are sent as a handle that stays the same for the life of the node, 0 is no node.
+typedef uint32_t ObjectHandle;
+
 
 struct EventRefreshPlugin : public Event {
 	EventRefreshPlugin() :Event(EventType::RefreshPlugin) {}
@@ -41,65 +43,113 @@ struct EventRefreshPlugin : public Event {
 	}
 };
 
+// Layout of the vertices in mesh payloads.
+enum class VertexEncoding : uint32_t {
+	Float,		// Vertex, 56 bytes
+	Packed,		// PackedVertex, 28 bytes
+	Quantized	// QuantizedVertex, 20 bytes
+};
+
+// Octahedral normal and tangent in 16 bit snorm and UV in half floats.
+// The binormal is cross(normal, tangent) * binormalSign.
+struct PackedVertex {
+	float position[3];
+	float binormalSign;
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t texcoord[2];
+};
+
+// As PackedVertex with 16 bit unorm positions inside the mesh bounds, binormalSign is 0 or 0xFFFF.
+struct QuantizedVertex {
+	uint16_t position[3];
+	uint16_t binormalSign;
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t texcoord[2];
+};
+
+// Quantized positions are positionOffset + position / 65535 * positionScale.
+struct VertexLayout {
+	VertexLayout() :encoding(VertexEncoding::Float), positionOffset(), positionScale() {}
+
+	uint32_t VertexSize() const {
+		switch(encoding) {
+			case VertexEncoding::Packed: return sizeof(PackedVertex);
+			case VertexEncoding::Quantized: return sizeof(QuantizedVertex);
+			default: return 56u;
+		}
+	}
+
+	VertexEncoding encoding;
+	Vec3f positionOffset;
+	Vec3f positionScale;
+};
+
+// Object space bounds of all of a mesh's positions. The sphere is centred on the box and reaches
+// its farthest vertex. A negative radius means the sender didn't compute them.
+struct MeshBounds {
+	MeshBounds() :min(), max(), center(), radius(-1.f) {}
+
+	Vec3f min;
+	Vec3f max;
+	Vec3f center;
+	float radius;
+};
+
+// Payload is vertexCount vertices encoded as in layout followed by indexCount indices of indexSize bytes.
 struct EventMeshCreated : public Event {
-	EventMeshCreated() :Event(EventType::MeshCreated), name{'\0'}, shaderName{'\0'}, textureFilePath{'\0'}, normalFilePath{'\0'}, 
-		color(), ambientColor(), vertexCount(0u) {}
+	EventMeshCreated() :Event(EventType::MeshCreated), handle(0u), shader(0u), textureFilePath{'\0'}, normalFilePath{'\0'}, 
+		color(), ambientColor(), vertexCount(0u), indexCount(0u), indexSize(0u) {}
 	virtual ~EventMeshCreated() override {};
 
 	static EventType GetStaticType() {
 		return EventType::MeshCreated;
 	}
 
-	char name[50];
-	char shaderName[50];
+	ObjectHandle handle;
+	ObjectHandle shader;
 	char textureFilePath[150];
 	char normalFilePath[150];
 	Vec4f color;
 	Vec3f ambientColor;
+	VertexLayout layout;
+	MeshBounds bounds;
 	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;
 };
 
 struct EventMeshDeleted : public Event {
-	EventMeshDeleted() :Event(EventType::MeshDeleted), name{'\0'}, shaderName{'\0'} {}
+	EventMeshDeleted() :Event(EventType::MeshDeleted), handle(0u), shader(0u) {}
 	virtual ~EventMeshDeleted() override {};
 
 	static EventType GetStaticType() {
 		return EventType::MeshDeleted;
 	}
 
-	char name[50];
-	char shaderName[50];
+	ObjectHandle handle;
+	ObjectHandle shader;
 };
 
 struct EventTransform : public Event {
-	EventTransform() :Event(EventType::Transform), transform(), isCamera(false), orthoWidth(10.f), fov(45.f), name{'\0'} {}
+	EventTransform() :Event(EventType::Transform), handle(0u), isCamera(false), isOrthographic(false), orthoWidth(10.f), fov(45.f), transform() {}
 	virtual ~EventTransform() override {};
 
 	static EventType GetStaticType() {
 		return EventType::Transform;
 	}
 
-	char name[50];
+	ObjectHandle handle;
 	bool isCamera;
+	bool isOrthographic;
 	float orthoWidth;
 	float fov;
 	Mat4f transform;
 };
 
-struct EventNameChanged : public Event {
-	EventNameChanged() :Event(EventType::NameChanged), newName{'\0'}, previousName{'\0'} {}
-	virtual ~EventNameChanged() override {};
-
-	static EventType GetStaticType() {
-		return EventType::NameChanged;
-	}
-
-	char newName[50];
-	char previousName[50];
-};
-
 struct EventMaterialModified : public Event {
-	EventMaterialModified() :Event(EventType::MaterialModified), name{'\0'}, textureFilePath{'\0'}, normalFilePath{'\0'},
+	EventMaterialModified() :Event(EventType::MaterialModified), shader(0u), textureFilePath{'\0'}, normalFilePath{'\0'},
 		color(), ambientColor() {}
 	virtual ~EventMaterialModified() override {};
 
@@ -107,7 +157,7 @@ struct EventMaterialModified : public Event {
 		return EventType::MaterialModified;
 	}
 
-	char name[50];
+	ObjectHandle shader;
 	char textureFilePath[150];
 	char normalFilePath[150];
 	Vec4f color;
@@ -115,7 +165,7 @@ struct EventMaterialModified : public Event {
 };
 
 struct EventMaterialChanged : public Event {
-	EventMaterialChanged() :Event(EventType::MaterialChanged), newName{'\0'}, meshName{'\0'}, textureFilePath{'\0'}, normalFilePath{'\0'},
+	EventMaterialChanged() :Event(EventType::MaterialChanged), shader(0u), mesh(0u), textureFilePath{'\0'}, normalFilePath{'\0'},
 		color(), ambientColor() {}
 	virtual ~EventMaterialChanged() override {};
 
@@ -123,36 +173,52 @@ struct EventMaterialChanged : public Event {
 		return EventType::MaterialChanged;
 	}
 
-	char newName[50];
-	char meshName[50];
+	ObjectHandle shader;
+	ObjectHandle mesh;
 	char textureFilePath[150];
 	char normalFilePath[150];
 	Vec4f color;
 	Vec3f ambientColor;
 };
 
+// Run of vertices in the mesh vertex buffer.
+struct VertexRange {
+	uint32_t start;
+	uint32_t count;
+};
+
+// Payload is the whole vertex buffer encoded as in layout when rangeCount is 0, otherwise rangeCount
+// VertexRanges followed by the vertices of each range in order. bounds are of the whole mesh after the edit.
 struct EventVertexModified : public Event {
-	EventVertexModified() :Event(EventType::VertexModified), name{'\0'}, vertexCount(0u) {}
+	EventVertexModified() :Event(EventType::VertexModified), handle(0u), vertexCount(0u), rangeCount(0u) {}
 	virtual ~EventVertexModified() override {};
 
 	static EventType GetStaticType() {
 		return EventType::VertexModified;
 	}
 
-	char name[50];
+	ObjectHandle handle;
+	VertexLayout layout;
+	MeshBounds bounds;
 	uint32_t vertexCount;
+	uint32_t rangeCount;
 };
 
+// Payload is vertexCount vertices encoded as in layout followed by indexCount indices of indexSize bytes.
 struct EventTopologyModified : public Event {
-	EventTopologyModified() :Event(EventType::TopologyModified), name{'\0'}, vertexCount(0u) {}
+	EventTopologyModified() :Event(EventType::TopologyModified), handle(0u), vertexCount(0u), indexCount(0u), indexSize(0u) {}
 	virtual ~EventTopologyModified() override {};
 
 	static EventType GetStaticType() {
 		return EventType::TopologyModified;
 	}
 
-	char name[50];
+	ObjectHandle handle;
+	VertexLayout layout;
+	MeshBounds bounds;
 	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;
 };
 
 
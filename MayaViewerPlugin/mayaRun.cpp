@@ -4,8 +4,16 @@
 #include<algorithm>
 #include<vector>
 #include<thread>
+#include<chrono>
 #include<queue>
+#include<deque>
+#include<mutex>
+#include<condition_variable>
+#include<memory>
+#include<set>
+#include<unordered_map>
 #include<cmath>
+#include<new>
 
 #include"Vector.h"
 #include"Matrix.h"
@@ -45,6 +53,20 @@ inline Vec3f& operator<< (Vec3f& v, const MVector& rhs) {
 	return v;
 }
 
+inline Vec3f& operator<< (Vec3f& v, const MFloatPoint& rhs) {
+	v.x = rhs.x;
+	v.y = rhs.y;
+	v.z = rhs.z;
+	return v;
+}
+
+inline Vec3f& operator<< (Vec3f& v, const MFloatVector& rhs) {
+	v.x = rhs.x;
+	v.y = rhs.y;
+	v.z = rhs.z;
+	return v;
+}
+
 struct Vertex {
 	Vec3f position;
 	Vec3f normal;
@@ -123,17 +145,80 @@ enum NODE_TYPE {TRANSFORM, MESH};
 bool endThread(false);
 std::thread update;
 const size_t megaByte(1024000ull);
-Comlib com(L"MayaViewer", megaByte * 500ull, ProcessType::Producer);
+Comlib com(L"MayaViewer", megaByte * 32ull, ProcessType::Producer);
 Comlib comRefresh(L"RefreshPlugin", megaByte, ProcessType::Consumer);
-MessageHeader messageHeader;
+char* stagingMsg(nullptr);
+bool linkStalled(false);
+const std::chrono::milliseconds linkTimeout(2000);
+std::unordered_map<ObjectHandle, std::set<int>> dirtyVertices;
+
+
+// Waits while the viewer makes room in the circular buffer. If it reads nothing for linkTimeout
+// it is taken to be gone and messages are dropped without waiting until the buffer has room again.
+
+bool WaitForViewer(const std::function<bool()>& trySend) {
+	std::chrono::steady_clock::time_point lastProgress = std::chrono::steady_clock::now();
+	size_t streamed = com.GetStreamOffset();
+
+	while(!trySend()) {
+		if(com.GetStreamOffset() != streamed) {
+			streamed = com.GetStreamOffset();
+			lastProgress = std::chrono::steady_clock::now();
+		}
+
+		if(linkStalled || std::chrono::steady_clock::now() - lastProgress > linkTimeout) {
+			if(!linkStalled) Print("Viewer is not reading, dropping messages until it catches up.\n");
+			linkStalled = true;
+			return false;
+		}
+
+		std::this_thread::yield();
+	}
+
+	linkStalled = false;
+	return true;
+}
 
 
-// Send message to circular buffer
+// Send message to circular buffer, in fragments if it is too large to go whole
 
 void SendMsg(void* msg, size_t size) {
-	messageHeader.messageLength = size;
-	for(uint32_t i = 0u; i < 100u; i++)
-		if(com.Send(msg, &messageHeader)) break;
+	if(!WaitForViewer([&]() {return com.SendStream(msg, size);}))
+		com.AbortStream();
+}
+
+// Small messages sent in bursts are packed into one record, which goes out on FlushMsg or
+// with the next message that is not batched.
+
+void BatchMsg(void* msg, size_t size) {
+	WaitForViewer([&]() {return com.SendBatched(msg, size);});
+}
+
+void FlushMsg() {
+	com.FlushBatch();
+}
+
+// Space to build a message in, in place in the circular buffer when it fits.
+// Larger messages are built in a staging buffer that CommitMsg streams.
+
+void* ReserveMsg(size_t size) {
+	if(size > com.GetMaxMessageLength()) {
+		stagingMsg = NEW char[size];
+		return stagingMsg;
+	}
+
+	void* data(nullptr);
+	WaitForViewer([&]() {return (data = com.Reserve(size)) != nullptr;});
+	return data;
+}
+
+void CommitMsg(size_t size) {
+	if(stagingMsg) {
+		SendMsg(stagingMsg, size);
+		delete[] stagingMsg;
+		stagingMsg = nullptr;
+	} else
+		com.Commit(size);
 }
 
 // Pre Defined Callback Functions
@@ -148,14 +233,12 @@ void NameChanged(MObject& node, const MString& str, void* clientData);
 void ObjectMoved(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
 void NodeRemoved(MObject& node, void* clientData);
 void NodeAdded(MObject& node, void* clientData);
+void SendVertexChanges(MObject& node);
+void SendMaterial(MObject& node);
 
 
 // General Functions
 
-uint32_t MStrLength(const MString& name) {
-	return (name.length() > 50u) ? 50u : name.length();
-}
-
 uint32_t MFileLength(const MString& filePath) {
 	return (filePath.length() > 150u) ? 150u : filePath.length();
 }
@@ -198,24 +281,21 @@ void GetTexture(MObject& shader, MString& diffuseFilePath, MString& normalFilePa
 	normalFilePlug.getValue(normalFilePath);
 }
 
-void GetShaderData(MObject& node, MString& name, MColor& color, MColor& ambientColor) {
+void GetShaderData(MObject& node, MColor& color, MColor& ambientColor) {
 	switch(node.apiType()) {
 		case MFn::kLambert: {
 			MFnLambertShader shader(node);
-			name = shader.name();
 			color = shader.color();
 			ambientColor = shader.ambientColor();
 
 		} break;
 		case MFn::kBlinn: {
 			MFnBlinnShader shader(node);
-			name = shader.name();
 			color = shader.color();
 			ambientColor = shader.ambientColor();
 		} break;
 		case MFn::kPhong: {
 			MFnPhongShader shader(node);
-			name = shader.name();
 			color = shader.color();
 			ambientColor = shader.ambientColor();
 		} break;
@@ -231,32 +311,58 @@ const MMatrix GetWorldMatrix(const MFnDagNode& dNode) {
 	return tMatrix.asMatrix() * parentMatrix;
 }
 
+// Handle the viewer knows a node by. It survives renames, so they need no message.
+// hashCode() is not unique, so each node gets its own sequential id; the hash only finds the bucket.
+struct HandleEntry {
+	MObjectHandle node;
+	ObjectHandle id;
+};
+std::unordered_map<unsigned int, std::vector<HandleEntry>> handleIds;
+ObjectHandle nextHandle(1u);
+
+ObjectHandle GetHandle(const MObject& node) {
+	if(node.isNull()) return 0u;
+
+	MObjectHandle mHandle(node);
+	std::vector<HandleEntry>& bucket = handleIds[mHandle.hashCode()];
+	for(const HandleEntry& entry : bucket)
+		if(entry.node.isValid() && entry.node == node) return entry.id;
+
+	// Dead nodes can leave their memory to a new one, so they must not match again.
+	bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [](const HandleEntry& entry) { return !entry.node.isValid(); }), bucket.end());
+	bucket.push_back({mHandle, nextHandle++});
+	return bucket.back().id;
+}
+
 void SetPos(const MObject& node, const bool& isCamera = false) {
 	MFnDagNode dNode(node);
-	MFnDependencyNode dNodeChild(MObject(dNode.child(0)));
 
 	float orthoWidth(10.f);
 	float fov(45.f);
+	bool isOrthographic(false);
 	if(isCamera) {
 		if(node.hasFn(MFn::kTransform)) {
 			MObject child(dNode.child(0));
 			MFnCamera camera(child);
 			orthoWidth = static_cast<float>(camera.orthoWidth());
 			fov = static_cast<float>(camera.horizontalFieldOfView());
+			isOrthographic = camera.isOrtho();
 		} else {
 			MFnCamera camera(node);
 			orthoWidth = static_cast<float>(camera.orthoWidth());
 			fov = static_cast<float>(camera.horizontalFieldOfView());
+			isOrthographic = camera.isOrtho();
 		}
 	} 
 
 	EventTransform e;
-	memcpy(e.name, dNodeChild.name().asChar(), MStrLength(dNodeChild.name()));
+	e.handle = GetHandle(dNode.child(0));
 	e.isCamera = isCamera;
+	e.isOrthographic = isOrthographic;
 	e.orthoWidth = orthoWidth;
 	e.fov = fov;
 	e.transform << GetWorldMatrix(dNode);
-	SendMsg(&e, sizeof(e));
+	BatchMsg(&e, sizeof(e));
 }
 
 void UpdateChildrenPos(const MObject& node) {
@@ -270,72 +376,547 @@ void UpdateChildrenPos(const MObject& node) {
 	}
 }
 
-void GetMeshData(MObject& node, std::vector<Vertex>& vertecies) {
-	
-	MFnMesh mesh(node);
+// Face corner a deduplicated vertex is read from. normal, uv and tangent are
+// ids into the bulk arrays and only filled in by the bulk path.
+struct MeshCorner {
+	uint32_t face;
+	int vertex;
+	int local;
+	int normal;
+	int uv;
+	int tangent;
+};
+
+// Corners sharing position, normal and UV ids share a vertex.
+struct CornerKey {
+	int vertex;
+	int normal;
+	int uv;
+
+	bool operator==(const CornerKey& other) const {
+		return vertex == other.vertex && normal == other.normal && uv == other.uv;
+	}
+};
+
+struct CornerKeyHash {
+	size_t operator()(const CornerKey& key) const {
+		return ((size_t)key.vertex * 73856093ull) ^ ((size_t)key.normal * 19349663ull) ^ ((size_t)key.uv * 83492791ull);
+	}
+};
+
+// Deduplicated vertices and triangle indices of a mesh, rebuilt when its topology changes.
+struct IndexedMesh {
+	std::vector<MeshCorner> corners;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> faceOffsets;
+	VertexLayout layout;
+	MeshBounds bounds;
+
+	uint32_t IndexSize() const {
+		return (corners.size() > 0xFFFFull) ? 4u : 2u;
+	}
+
+	size_t DataSize() const {
+		return layout.VertexSize() * corners.size() + IndexSize() * indices.size();
+	}
+};
+
+std::unordered_map<ObjectHandle, IndexedMesh> indexedMeshes;
+
+
+// Vertex encoding. Setting the optionVar MayaViewerVertexEncoding before loading sends meshes
+// as PackedVertex (1) or QuantizedVertex (2) instead of full float vertices.
+
+VertexEncoding vertexEncoding(VertexEncoding::Float);
+
+
+// Mesh extraction. The bulk path reads whole arrays from MFnMesh and triangulates any polygon,
+// the corner path asks Maya for every triangle corner and only handles triangles and quads.
+// Setting the optionVar MayaViewerCornerExtraction to 1 before loading selects the corner path.
+
+enum class Extraction {Corner, Bulk};
+Extraction extraction(Extraction::Bulk);
+
+// Time spent reading meshes from Maya.
+struct ExtractionCounter {
+	std::chrono::steady_clock::duration time{};
+	uint64_t meshes = 0ull;
+	uint64_t vertices = 0ull;
+
+	void Add(std::chrono::steady_clock::time_point start, size_t vertexCount) {
+		Add(std::chrono::steady_clock::now() - start, vertexCount);
+	}
+
+	void Add(std::chrono::steady_clock::duration elapsed, size_t vertexCount) {
+		time += elapsed;
+		vertices += vertexCount;
+		meshes++;
+	}
+
+	void Report() {
+		double ms = std::chrono::duration<double, std::milli>(time).count();
+		Print("// Mesh extraction ({0}): {1} ms for {2} meshes, {3} vertices\n",
+			(extraction == Extraction::Bulk) ? "bulk" : "corner", ms, meshes, vertices);
+	}
+};
+
+ExtractionCounter extractionCounter;
+
+void BuildIndexedMeshCorner(MFnMesh& mesh, IndexedMesh& indexed) {
 	uint32_t faceCount = mesh.numPolygons();
+	indexed.faceOffsets.resize(faceCount);
 
+	std::unordered_map<CornerKey, uint32_t, CornerKeyHash> lookup;
 	for(uint32_t i = 0u; i < faceCount; i++) {
+		indexed.faceOffsets[i] = (uint32_t)indexed.indices.size();
 
-		int ind[3];
-		MStatus s1 = mesh.getPolygonTriangleVertices(i, 0u, ind);
-		MStatus s2 = mesh.getPolygonTriangleVertices(i, 1u, ind);
+		MIntArray faceVertices;
+		MIntArray normalIds;
+		mesh.getPolygonVertices(i, faceVertices);
+		mesh.getFaceNormalIds(i, normalIds);
 
 		for(uint32_t j = 0u; j < 2u; j++) {
 
-			status = mesh.getPolygonTriangleVertices(i, j, ind);
-
-			if(!status.error()) {
-				for(uint32_t k = 0u; k < 3u; k++) {
-					// Position
-					MPoint pos;
-					mesh.getPoint(ind[k], pos);
-
-					// Normal
-					MVector normal;
-					mesh.getFaceVertexNormal(i, ind[k], normal);
-
-					// Tangent
-					MVector tangent;
-					mesh.getFaceVertexTangent(i, ind[k], tangent);
-
-					// BiTangent
-					MVector biTangent;
-					mesh.getFaceVertexBinormal(i, ind[k], biTangent);
-
-					Vertex v;
-					v.position	<< pos;
-					v.normal	<< normal;
-					v.tangent	<< tangent;
-					v.biTangent << biTangent;
-
-					// Texcoord
-					if(!s1.error() && s2.error())
-						mesh.getPolygonUV(i, k, v.texcoord.x, v.texcoord.y); // If single triangle, UV Order: 0, 1, 2
-					else if(!j)
-						mesh.getPolygonUV(i, (k > 1u) ? 3 : k, v.texcoord.x, v.texcoord.y); // If two triangle, first triangle UV Order: 0, 1, 3
-					else
-						mesh.getPolygonUV(i, (!k) ? 3u : k, v.texcoord.x, v.texcoord.y); // If two triangle, second triangle UV Order: 3, 1, 2
-
-					vertecies.emplace_back(v);
+			int ind[3];
+			if(mesh.getPolygonTriangleVertices(i, j, ind).error()) continue;
+
+			for(uint32_t k = 0u; k < 3u; k++) {
+				int local(0);
+				while(local < (int)faceVertices.length() - 1 && faceVertices[local] != ind[k]) local++;
+
+				int uvId(-1);
+				if(mesh.getPolygonUVid(i, local, uvId).error()) uvId = -1;
+
+				CornerKey key{ind[k], (local < (int)normalIds.length()) ? normalIds[local] : -1, uvId};
+				auto inserted = lookup.emplace(key, (uint32_t)indexed.corners.size());
+				if(inserted.second) indexed.corners.push_back({i, ind[k], local, key.normal, uvId, -1});
+
+				indexed.indices.push_back(inserted.first->second);
+			}
+		}
+	}
+}
+
+// Raw arrays read in bulk from MFnMesh. Reading them needs Maya, everything built from them does not.
+struct MeshArrays {
+	MIntArray vertexCounts, vertexIds;
+	MIntArray normalCounts, normalIds;
+	MIntArray uvCounts, uvIds;
+	MIntArray triangleCounts, triangleOffsets;
+	std::vector<int> tangentIds;
+
+	MFloatPointArray points;
+	MFloatVectorArray normals, tangents, biTangents;
+	MFloatArray us, vs;
+};
+
+void GetTopologyArrays(MFnMesh& mesh, MeshArrays& arrays) {
+	mesh.getVertices(arrays.vertexCounts, arrays.vertexIds);
+	mesh.getNormalIds(arrays.normalCounts, arrays.normalIds);
+	mesh.getAssignedUVs(arrays.uvCounts, arrays.uvIds);
+	mesh.getTriangleOffsets(arrays.triangleCounts, arrays.triangleOffsets);
+
+	// Tangent id of every face vertex. There is no bulk call and tangents split at UV seams where
+	// normals may not, so every face vertex is asked. Only topology changes get here, vertex edits don't.
+	arrays.tangentIds.resize(arrays.vertexIds.length());
+	uint32_t faceVertex(0u);
+	for(uint32_t i = 0u; i < arrays.vertexCounts.length(); i++) {
+		for(int j = 0; j < arrays.vertexCounts[i]; j++, faceVertex++)
+			arrays.tangentIds[faceVertex] = mesh.getTangentId(i, arrays.vertexIds[faceVertex]);
+	}
+}
+
+void GetVertexArrays(MFnMesh& mesh, MeshArrays& arrays) {
+	mesh.getPoints(arrays.points);
+	mesh.getNormals(arrays.normals);
+	mesh.getTangents(arrays.tangents);
+	mesh.getBinormals(arrays.biTangents);
+	mesh.getUVs(arrays.us, arrays.vs);
+}
+
+void BuildIndexedMeshBulk(const MeshArrays& arrays, IndexedMesh& indexed) {
+	uint32_t faceCount = arrays.vertexCounts.length();
+	indexed.faceOffsets.resize(faceCount);
+	indexed.indices.reserve(arrays.triangleOffsets.length());
+
+	std::unordered_map<CornerKey, uint32_t, CornerKeyHash> lookup;
+	lookup.reserve(arrays.vertexIds.length());
+
+	// Face vertex arrays are flat, walk them alongside the faces.
+	uint32_t faceVertex(0u);
+	uint32_t faceUV(0u);
+	uint32_t triangleCorner(0u);
+	for(uint32_t i = 0u; i < faceCount; i++) {
+		indexed.faceOffsets[i] = (uint32_t)indexed.indices.size();
+
+		bool hasUVs = i < arrays.uvCounts.length() && arrays.uvCounts[i] > 0;
+		uint32_t cornerCount = (i < arrays.triangleCounts.length()) ? arrays.triangleCounts[i] * 3u : 0u;
+
+		for(uint32_t k = 0u; k < cornerCount; k++) {
+			int local = arrays.triangleOffsets[triangleCorner + k];
+			uint32_t id = faceVertex + local;
+
+			CornerKey key{arrays.vertexIds[id], arrays.normalIds[id], hasUVs ? arrays.uvIds[faceUV + local] : -1};
+			auto inserted = lookup.emplace(key, (uint32_t)indexed.corners.size());
+			if(inserted.second) indexed.corners.push_back({i, key.vertex, local, key.normal, key.uv, arrays.tangentIds[id]});
+
+			indexed.indices.push_back(inserted.first->second);
+		}
+
+		faceVertex += arrays.vertexCounts[i];
+		if(hasUVs) faceUV += arrays.uvCounts[i];
+		triangleCorner += cornerCount;
+	}
+}
+
+void BuildIndexedMesh(MObject& node, IndexedMesh& indexed) {
+	MFnMesh mesh(node);
+
+	indexed.corners.clear();
+	indexed.indices.clear();
+	indexed.layout = VertexLayout();
+	indexed.layout.encoding = vertexEncoding;
+
+	if(extraction == Extraction::Bulk) {
+		MeshArrays arrays;
+		GetTopologyArrays(mesh, arrays);
+		BuildIndexedMeshBulk(arrays, indexed);
+	}
+	else
+		BuildIndexedMeshCorner(mesh, indexed);
+}
+
+// Indexing of a mesh, built on first use or when asked to after a topology change.
+IndexedMesh& GetIndexedMesh(MObject& node, bool rebuild = false) {
+	ObjectHandle handle = GetHandle(node);
+
+	auto it = indexedMeshes.find(handle);
+	if(it == indexedMeshes.end()) {
+		it = indexedMeshes.emplace(handle, IndexedMesh()).first;
+		rebuild = true;
+	}
+
+	if(rebuild || it->second.faceOffsets.size() != (size_t)MFnMesh(node).numPolygons())
+		BuildIndexedMesh(node, it->second);
+
+	return it->second;
+}
+
+Vertex GetCornerVertex(MFnMesh& mesh, const MeshCorner& corner) {
+	// Position
+	MPoint pos;
+	mesh.getPoint(corner.vertex, pos);
+
+	// Normal
+	MVector normal;
+	mesh.getFaceVertexNormal(corner.face, corner.vertex, normal);
+
+	// Tangent
+	MVector tangent;
+	mesh.getFaceVertexTangent(corner.face, corner.vertex, tangent);
+
+	// BiTangent
+	MVector biTangent;
+	mesh.getFaceVertexBinormal(corner.face, corner.vertex, biTangent);
+
+	Vertex v;
+	v.position	<< pos;
+	v.normal	<< normal;
+	v.tangent	<< tangent;
+	v.biTangent << biTangent;
+
+	// Texcoord
+	mesh.getPolygonUV(corner.face, corner.local, v.texcoord.x, v.texcoord.y);
+
+	return v;
+}
+
+// Writes the vertices of the given corners, or of all corners when ids is null.
+void GetVerticesBulk(const MeshArrays& arrays, const IndexedMesh& indexed, const uint32_t* ids, uint32_t count, Vertex* vertecies) {
+	for(uint32_t i = 0u; i < count; i++) {
+		const MeshCorner& corner = indexed.corners[ids ? ids[i] : i];
+
+		Vertex v;
+		v.position << arrays.points[corner.vertex];
+		if(corner.normal >= 0) v.normal << arrays.normals[corner.normal];
+		if(corner.tangent >= 0 && corner.tangent < (int)arrays.tangents.length()) {
+			v.tangent	<< arrays.tangents[corner.tangent];
+			v.biTangent << arrays.biTangents[corner.tangent];
+		}
+		if(corner.uv >= 0) {
+			v.texcoord.x = arrays.us[corner.uv];
+			v.texcoord.y = arrays.vs[corner.uv];
+		}
+
+		vertecies[i] = v;
+	}
+}
+
+// A corner read costs about as much as this many entries of the bulk arrays.
+const uint32_t cornerReadCost(32u);
+
+void GetVertices(MObject& node, const IndexedMesh& indexed, const uint32_t* ids, uint32_t count, Vertex* vertecies) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	MFnMesh mesh(node);
+
+	// Small edits read just their corners instead of every array of the mesh.
+	bool fewCorners = ids && (size_t)count * cornerReadCost < indexed.corners.size();
+	if(extraction == Extraction::Corner || fewCorners) {
+		for(uint32_t i = 0u; i < count; i++)
+			vertecies[i] = GetCornerVertex(mesh, indexed.corners[ids ? ids[i] : i]);
+	}
+	else {
+		MeshArrays arrays;
+		GetVertexArrays(mesh, arrays);
+		GetVerticesBulk(arrays, indexed, ids, count, vertecies);
+	}
+
+	extractionCounter.Add(start, count);
+}
+
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (bits >> 16u) & 0x8000u;
+	int32_t exponent = (int32_t)((bits >> 23u) & 0xFFu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFFu;
+
+	if(exponent <= 0) return sign; // Too small, flushed to zero
+	if(exponent >= 31) return sign | 0x7C00u; // Too large, infinity
+
+	// Round to nearest
+	uint16_t half = sign | (uint16_t)(exponent << 10u) | (uint16_t)(mantissa >> 13u);
+	if(mantissa & 0x1000u) half++;
+	return half;
+}
+
+int16_t FloatToSnorm(float value) {
+	return (int16_t)std::lround(std::max(-1.f, std::min(1.f, value)) * 32767.f);
+}
+
+// Maps a unit vector onto the octahedron unfolded into [-1, 1]^2.
+void EncodeOctahedral(const Vec3f& v, int16_t* out) {
+	float length = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+	if(length <= 0.f) {
+		out[0] = out[1] = 0;
+		return;
+	}
+
+	float x = v.x / length;
+	float y = v.y / length;
+	if(v.z < 0.f) {
+		float foldX = (1.f - std::fabs(y)) * ((x >= 0.f) ? 1.f : -1.f);
+		float foldY = (1.f - std::fabs(x)) * ((y >= 0.f) ? 1.f : -1.f);
+		x = foldX;
+		y = foldY;
+	}
+
+	out[0] = FloatToSnorm(x);
+	out[1] = FloatToSnorm(y);
+}
+
+bool IsBinormalFlipped(const Vertex& v) {
+	Vec3f c;
+	c.x = v.normal.y * v.tangent.z - v.normal.z * v.tangent.y;
+	c.y = v.normal.z * v.tangent.x - v.normal.x * v.tangent.z;
+	c.z = v.normal.x * v.tangent.y - v.normal.y * v.tangent.x;
+	return c.x * v.biTangent.x + c.y * v.biTangent.y + c.z * v.biTangent.z < 0.f;
+}
+
+float DistanceSquared(const Vec3f& a, const Vec3f& b) {
+	float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+	return x * x + y * y + z * z;
+}
+
+// Box of the positions, then the sphere around its centre out to the farthest one.
+void FitBounds(const Vertex* vertecies, uint32_t count, MeshBounds& bounds) {
+	Vec3f min, max;
+	for(uint32_t i = 0u; i < 3u; i++) {
+		min.arr[i] = count ? vertecies[0].position.arr[i] : 0.f;
+		max.arr[i] = min.arr[i];
+	}
+
+	for(uint32_t i = 1u; i < count; i++) {
+		for(uint32_t j = 0u; j < 3u; j++) {
+			min.arr[j] = std::min(min.arr[j], vertecies[i].position.arr[j]);
+			max.arr[j] = std::max(max.arr[j], vertecies[i].position.arr[j]);
+		}
+	}
+
+	bounds.min = min;
+	bounds.max = max;
+	for(uint32_t i = 0u; i < 3u; i++)
+		bounds.center.arr[i] = (min.arr[i] + max.arr[i]) * 0.5f;
+
+	float radiusSquared(0.f);
+	for(uint32_t i = 0u; i < count; i++)
+		radiusSquared = std::max(radiusSquared, DistanceSquared(vertecies[i].position, bounds.center));
+	bounds.radius = std::sqrt(radiusSquared);
+}
+
+// Partial edits only see the vertices they move, so the bounds grow to take them in but never shrink.
+void GrowBounds(const Vertex* vertecies, uint32_t count, MeshBounds& bounds) {
+	Vec3f oldCenter = bounds.center;
+	for(uint32_t i = 0u; i < count; i++) {
+		for(uint32_t j = 0u; j < 3u; j++) {
+			bounds.min.arr[j] = std::min(bounds.min.arr[j], vertecies[i].position.arr[j]);
+			bounds.max.arr[j] = std::max(bounds.max.arr[j], vertecies[i].position.arr[j]);
+		}
+	}
+
+	for(uint32_t i = 0u; i < 3u; i++)
+		bounds.center.arr[i] = (bounds.min.arr[i] + bounds.max.arr[i]) * 0.5f;
+
+	// The old sphere moved to the new centre still holds every vertex that wasn't sent.
+	float radius = bounds.radius + std::sqrt(DistanceSquared(oldCenter, bounds.center));
+	for(uint32_t i = 0u; i < count; i++)
+		radius = std::max(radius, std::sqrt(DistanceSquared(vertecies[i].position, bounds.center)));
+	bounds.radius = radius;
+}
+
+bool InsideBounds(const Vertex* vertecies, uint32_t count, const VertexLayout& layout) {
+	for(uint32_t i = 0u; i < count; i++) {
+		for(uint32_t j = 0u; j < 3u; j++) {
+			float p = vertecies[i].position.arr[j] - layout.positionOffset.arr[j];
+			if(p < 0.f || p > layout.positionScale.arr[j]) return false;
+		}
+	}
+
+	return true;
+}
+
+// Writes vertices in the layout's encoding, quantized positions need fitted bounds.
+void EncodeVertices(const Vertex* vertecies, uint32_t count, const VertexLayout& layout, void* data) {
+	switch(layout.encoding) {
+		case VertexEncoding::Packed: {
+			PackedVertex* out = (PackedVertex*)data;
+			for(uint32_t i = 0u; i < count; i++, out++) {
+				const Vertex& v = vertecies[i];
+				memcpy(out->position, v.position.arr, sizeof(out->position));
+				out->binormalSign = IsBinormalFlipped(v) ? -1.f : 1.f;
+				EncodeOctahedral(v.normal, out->normal);
+				EncodeOctahedral(v.tangent, out->tangent);
+				out->texcoord[0] = FloatToHalf(v.texcoord.x);
+				out->texcoord[1] = FloatToHalf(v.texcoord.y);
+			}
+		} break;
+		case VertexEncoding::Quantized: {
+			float invScale[3];
+			for(uint32_t j = 0u; j < 3u; j++)
+				invScale[j] = (layout.positionScale.arr[j] > 0.f) ? 65535.f / layout.positionScale.arr[j] : 0.f;
+
+			QuantizedVertex* out = (QuantizedVertex*)data;
+			for(uint32_t i = 0u; i < count; i++, out++) {
+				const Vertex& v = vertecies[i];
+				for(uint32_t j = 0u; j < 3u; j++) {
+					float p = (v.position.arr[j] - layout.positionOffset.arr[j]) * invScale[j];
+					out->position[j] = (uint16_t)std::lround(std::max(0.f, std::min(65535.f, p)));
 				}
+				out->binormalSign = IsBinormalFlipped(v) ? 0u : 0xFFFFu;
+				EncodeOctahedral(v.normal, out->normal);
+				EncodeOctahedral(v.tangent, out->tangent);
+				out->texcoord[0] = FloatToHalf(v.texcoord.x);
+				out->texcoord[1] = FloatToHalf(v.texcoord.y);
 			}
+		} break;
+		default:
+			memcpy(data, vertecies, sizeof(Vertex) * count);
+			break;
+	}
+}
+
+// Writes the vertices of a whole mesh and fits its bounds, quantized positions fill the box.
+void WriteMeshVertices(const Vertex* vertecies, IndexedMesh& indexed, uint32_t count, void* data) {
+	FitBounds(vertecies, count, indexed.bounds);
+
+	VertexLayout& layout = indexed.layout;
+	if(layout.encoding == VertexEncoding::Quantized) {
+		for(uint32_t i = 0u; i < 3u; i++) {
+			layout.positionOffset.arr[i] = indexed.bounds.min.arr[i];
+			layout.positionScale.arr[i] = indexed.bounds.max.arr[i] - indexed.bounds.min.arr[i];
 		}
 	}
+
+	EncodeVertices(vertecies, count, layout, data);
 }
 
-bool AddMesh(MObject& node) {
+// Indices are 16 bit when they fit.
+void GetIndexData(const IndexedMesh& indexed, void* data) {
+	if(indexed.IndexSize() == 2u) {
+		uint16_t* indices = (uint16_t*)data;
+		for(uint32_t i : indexed.indices)
+			*indices++ = (uint16_t)i;
+	}
+	else
+		memcpy(data, indexed.indices.data(), sizeof(uint32_t) * indexed.indices.size());
+}
+
+// Writes the vertices followed by the indices. Float vertices are read in place.
+void GetMeshData(MObject& node, IndexedMesh& indexed, void* data) {
+	uint32_t vertexCount = (uint32_t)indexed.corners.size();
+
+	if(indexed.layout.encoding == VertexEncoding::Float) {
+		GetVertices(node, indexed, nullptr, vertexCount, (Vertex*)data);
+		FitBounds((const Vertex*)data, vertexCount, indexed.bounds);
+	}
+	else {
+		std::vector<Vertex> vertecies(vertexCount);
+		GetVertices(node, indexed, nullptr, vertexCount, vertecies.data());
+		WriteMeshVertices(vertecies.data(), indexed, vertexCount, data);
+	}
 
-	MStatus status;
+	GetIndexData(indexed, (char*)data + indexed.layout.VertexSize() * vertexCount);
+}
+
+// Faces whose vertices change when the dirty vertices move. Moving a vertex changes the normals
+// and tangents of every vertex on the faces around it, so the faces around those are dirty too.
+std::vector<uint32_t> GetDirtyFaces(MObject& node, const std::set<int>& dirtyVertices) {
 	MFnMesh mesh(node);
-	MFnDagNode dNode(node);
+	MItMeshVertex itVertex(node);
+
+	std::set<int> ringFaces;
+	std::set<int> ringVertices;
+	int previous(0);
+	for(int vertex : dirtyVertices) {
+		MIntArray faces;
+		if(itVertex.setIndex(vertex, previous).error()) continue;
+		itVertex.getConnectedFaces(faces);
+
+		for(uint32_t i = 0u; i < faces.length(); i++) {
+			if(!ringFaces.insert(faces[i]).second) continue;
+
+			MIntArray faceVertices;
+			mesh.getPolygonVertices(faces[i], faceVertices);
+			for(uint32_t j = 0u; j < faceVertices.length(); j++)
+				ringVertices.insert(faceVertices[j]);
+		}
+	}
+
+	std::set<int> dirtyFaces;
+	for(int vertex : ringVertices) {
+		MIntArray faces;
+		if(itVertex.setIndex(vertex, previous).error()) continue;
+		itVertex.getConnectedFaces(faces);
 
-	// Mesh
-	std::vector<Vertex> vertecies;
-	GetMeshData(node, vertecies);
+		for(uint32_t i = 0u; i < faces.length(); i++)
+			dirtyFaces.insert(faces[i]);
+	}
+
+	return std::vector<uint32_t>(dirtyFaces.begin(), dirtyFaces.end());
+}
 
-	// Material
-	MString shaderName;
+// Material of a mesh, read on the main thread so it can be written to a message anywhere.
+struct MeshMaterial {
+	ObjectHandle shader;
+	std::string textureFilePath;
+	std::string normalFilePath;
+	Vec4f color;
+	Vec3f ambientColor;
+};
+
+void GetMeshMaterial(MObject& node, MeshMaterial& material) {
+	ObjectHandle shaderHandle(0u);
 	MString textureFilePath;
 	MString normalFilePath;
 	MColor color;
@@ -343,7 +924,7 @@ bool AddMesh(MObject& node) {
 
 	MObjectArray shaderEngines;
 	MIntArray shaderIndecies;
-	mesh.getConnectedShaders(0u, shaderEngines, shaderIndecies);
+	MFnMesh(node).getConnectedShaders(0u, shaderEngines, shaderIndecies);
 	for(auto& i : shaderEngines) {
 		MPlug surface = MFnDependencyNode(i).findPlug("surfaceShader");
 
@@ -353,28 +934,47 @@ bool AddMesh(MObject& node) {
 		if(srcPlugs.length() > 0u) shader = srcPlugs[0].node();
 		
 		GetTexture(shader, textureFilePath, normalFilePath);
-		GetShaderData(shader, shaderName, color, ambientColor);
+		GetShaderData(shader, color, ambientColor);
+		shaderHandle = GetHandle(shader);
 	}
 
+	material.shader = shaderHandle;
+	material.textureFilePath.assign(textureFilePath.asChar(), MFileLength(textureFilePath));
+	material.normalFilePath.assign(normalFilePath.asChar(), MFileLength(normalFilePath));
+	material.color << color;
+	material.ambientColor << ambientColor;
+}
 
-	if(vertecies.size()) {
-		EventMeshCreated e;
-		memcpy(e.name, dNode.name().asChar(), MStrLength(dNode.name()));
-		memcpy(e.shaderName, shaderName.asChar(), MStrLength(shaderName));
-		memcpy(e.textureFilePath, textureFilePath.asChar(), MFileLength(textureFilePath));
-		memcpy(e.normalFilePath, normalFilePath.asChar(), MFileLength(normalFilePath));
-		e.color << color;
-		e.ambientColor << ambientColor;
-		e.vertexCount = static_cast<uint32_t>(vertecies.size());
+// Writes everything but the payload of an EventMeshCreated.
+EventMeshCreated* NewMeshCreated(void* data, ObjectHandle handle, const MeshMaterial& material, const IndexedMesh& indexed) {
+	EventMeshCreated* e = new(data) EventMeshCreated();
+	e->handle = handle;
+	e->shader = material.shader;
+	memcpy(e->textureFilePath, material.textureFilePath.c_str(), material.textureFilePath.size());
+	memcpy(e->normalFilePath, material.normalFilePath.c_str(), material.normalFilePath.size());
+	e->color = material.color;
+	e->ambientColor = material.ambientColor;
+	e->vertexCount = (uint32_t)indexed.corners.size();
+	e->indexCount = (uint32_t)indexed.indices.size();
+	e->indexSize = indexed.IndexSize();
+	return e;
+}
 
-		uint32_t eventSize = sizeof(EventMeshCreated);
-		uint32_t vertSize = sizeof(Vertex) * e.vertexCount;
-		uint32_t fullSize = eventSize + vertSize;
-		char* data = NEW char[fullSize];
-		memcpy(data, &e, eventSize);
-		memcpy(data + sizeof(e), vertecies.data(), vertSize);
-		SendMsg(data, fullSize);
-		delete[] data;
+bool AddMesh(MObject& node) {
+	IndexedMesh& indexed = GetIndexedMesh(node, true);
+
+	MeshMaterial material;
+	GetMeshMaterial(node, material);
+
+	if(!indexed.indices.empty()) {
+		void* data = ReserveMsg(sizeof(EventMeshCreated) + indexed.DataSize());
+		if(data) {
+			EventMeshCreated* e = NewMeshCreated(data, GetHandle(node), material, indexed);
+			GetMeshData(node, indexed, e + 1);
+			e->layout = indexed.layout;
+			e->bounds = indexed.bounds;
+			CommitMsg(sizeof(EventMeshCreated) + indexed.DataSize());
+		}
 
 		return true;
 	}
@@ -383,6 +983,344 @@ bool AddMesh(MObject& node) {
 }
 
 
+// Scene export at load. The main thread reads each mesh from Maya, a pool of workers builds
+// the messages and the main thread sends them in the order the meshes were read.
+
+class SceneExporter {
+	public:
+
+	SceneExporter(uint32_t workerCount)
+		:m_start(std::chrono::steady_clock::now()), m_maxInFlight(workerCount * 4u), m_stop(false),
+		m_meshCount(0ull), m_vertexCount(0ull), m_byteCount(0ull), m_readTime(), m_buildTime(), m_sendTime() {
+		for(uint32_t i = 0u; i < workerCount; i++)
+			m_workers.emplace_back(&SceneExporter::Work, this);
+	}
+
+	~SceneExporter() {
+		Finish();
+	}
+
+	// Without workers the mesh is sent right away.
+	void Submit(MObject& node) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if(m_workers.empty()) {
+			bool added = AddMesh(node);
+			const IndexedMesh& indexed = GetIndexedMesh(node);
+			m_readTime += std::chrono::steady_clock::now() - start;
+
+			SendPosition(node);
+			Count(added ? sizeof(EventMeshCreated) + indexed.DataSize() : 0ull, indexed.corners.size());
+			return;
+		}
+
+		Job* job = new Job();
+		job->node = node;
+		job->handle = GetHandle(node);
+		GetMeshMaterial(node, job->material);
+
+		MFnMesh mesh(node);
+		GetTopologyArrays(mesh, job->arrays);
+		GetVertexArrays(mesh, job->arrays);
+		job->readTime = std::chrono::steady_clock::now() - start;
+		m_readTime += job->readTime;
+
+		m_jobs.emplace_back(job);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pending.push(job);
+		}
+		m_workReady.notify_one();
+
+		SendDone(m_jobs.size() >= m_maxInFlight);
+	}
+
+	// Sends what is left, stops the workers and reports.
+	void Finish() {
+		if(m_stop) return;
+
+		while(!m_jobs.empty())
+			SendDone(true);
+		FlushMsg();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_workReady.notify_all();
+		for(std::thread& worker : m_workers)
+			worker.join();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		double megaBytes = m_byteCount / (1024.0 * 1024.0);
+		Print("// Exported {0} meshes, {1} vertices, {2} MB in {3} s ({4} meshes/s, {5} MB/s)\n",
+			m_meshCount, m_vertexCount, megaBytes, seconds, m_meshCount / std::max(seconds, 1e-9), megaBytes / std::max(seconds, 1e-9));
+		Print("// Read {0} ms, build {1} ms over {2} workers, send {3} ms\n",
+			std::chrono::duration<double, std::milli>(m_readTime).count(),
+			std::chrono::duration<double, std::milli>(m_buildTime).count(), m_workers.size(),
+			std::chrono::duration<double, std::milli>(m_sendTime).count());
+	}
+
+	private:
+
+	struct Job {
+		MObject node;
+		ObjectHandle handle;
+		MeshMaterial material;
+		MeshArrays arrays;
+		IndexedMesh indexed;
+		std::vector<char> message;
+		std::chrono::steady_clock::duration readTime{};
+		bool done = false;
+	};
+
+	void Work() {
+		while(true) {
+			Job* job(nullptr);
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_workReady.wait(lock, [&]() { return m_stop || !m_pending.empty(); });
+				if(m_pending.empty()) return;
+
+				job = m_pending.front();
+				m_pending.pop();
+			}
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			IndexedMesh& indexed = job->indexed;
+			indexed.layout.encoding = vertexEncoding;
+			BuildIndexedMeshBulk(job->arrays, indexed);
+
+			if(!indexed.indices.empty()) {
+				job->message.resize(sizeof(EventMeshCreated) + indexed.DataSize());
+				EventMeshCreated* e = NewMeshCreated(job->message.data(), job->handle, job->material, indexed);
+
+				if(indexed.layout.encoding == VertexEncoding::Float) {
+					GetVerticesBulk(job->arrays, indexed, nullptr, e->vertexCount, (Vertex*)(e + 1));
+					FitBounds((const Vertex*)(e + 1), e->vertexCount, indexed.bounds);
+				}
+				else {
+					std::vector<Vertex> vertecies(e->vertexCount);
+					GetVerticesBulk(job->arrays, indexed, nullptr, e->vertexCount, vertecies.data());
+					WriteMeshVertices(vertecies.data(), indexed, e->vertexCount, e + 1);
+				}
+
+				GetIndexData(indexed, (char*)(e + 1) + indexed.layout.VertexSize() * e->vertexCount);
+				e->layout = indexed.layout;
+				e->bounds = indexed.bounds;
+			}
+			job->arrays = MeshArrays();
+
+			std::chrono::steady_clock::duration buildTime = std::chrono::steady_clock::now() - start;
+			{
+				// The counter is shared with the other workers, so it is fed under the lock.
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_buildTime += buildTime;
+				extractionCounter.Add(job->readTime + buildTime, job->indexed.corners.size());
+				job->done = true;
+			}
+			m_jobDone.notify_all();
+		}
+	}
+
+	// Sends the finished meshes at the front of the queue, waits for the first one if asked to.
+	void SendDone(bool wait) {
+		while(!m_jobs.empty()) {
+			Job* job = m_jobs.front().get();
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if(!job->done && !wait) return;
+				m_jobDone.wait(lock, [&]() { return job->done; });
+			}
+			wait = false;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(!job->message.empty())
+				SendMsg(job->message.data(), job->message.size());
+			m_sendTime += std::chrono::steady_clock::now() - start;
+
+			Count(job->message.size(), job->indexed.corners.size());
+			indexedMeshes[job->handle] = std::move(job->indexed);
+			SendPosition(job->node);
+			m_jobs.pop_front();
+		}
+	}
+
+	// The viewer only places nodes it has, so positions follow the mesh.
+	void SendPosition(MObject& node) {
+		MObject parent(MFnDagNode(node).parent(0));
+		SetPos(parent);
+		UpdateChildrenPos(parent);
+	}
+
+	void Count(size_t bytes, size_t vertices) {
+		m_meshCount++;
+		m_vertexCount += vertices;
+		m_byteCount += bytes;
+	}
+
+	std::chrono::steady_clock::time_point m_start;
+	size_t m_maxInFlight;
+	bool m_stop;
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::unique_ptr<Job>> m_jobs;
+	std::queue<Job*> m_pending;
+	std::mutex m_mutex;
+	std::condition_variable m_workReady;
+	std::condition_variable m_jobDone;
+
+	uint64_t m_meshCount;
+	uint64_t m_vertexCount;
+	uint64_t m_byteCount;
+	std::chrono::steady_clock::duration m_readTime;
+	std::chrono::steady_clock::duration m_buildTime;
+	std::chrono::steady_clock::duration m_sendTime;
+};
+
+
+// Changes to transforms, vertices and materials are collected until Maya is idle or the current
+// time changes and only the latest state of each node is sent then. Idle doesn't come while
+// playback or scrubbing keeps Maya busy, the time change does once per frame.
+
+class DirtyNodes {
+	public:
+
+	DirtyNodes()
+		:m_idleCallback(0), m_timeCallback(0), m_counts() {}
+
+	void MarkTransform(const MObject& node, bool isCamera) {
+		Mark(m_transforms, node, isCamera, Transform);
+	}
+
+	void MarkVertices(const MObject& node) {
+		Mark(m_vertices, node, false, Vertices);
+	}
+
+	void MarkMaterial(const MObject& node) {
+		Mark(m_materials, node, false, Material);
+	}
+
+	// Pending changes of a node that was removed or sent some other way.
+	void Forget(ObjectHandle handle) {
+		m_transforms.erase(handle);
+		m_vertices.erase(handle);
+		m_materials.erase(handle);
+	}
+
+	void ForgetVertices(ObjectHandle handle) {
+		m_vertices.erase(handle);
+	}
+
+	void Flush() {
+		Clear();
+
+		// A moved transform moves its children as well, each is sent once.
+		std::unordered_map<ObjectHandle, Pending> transforms;
+		transforms.swap(m_transforms);
+		std::set<ObjectHandle> sent;
+		for(auto& [handle, pending] : transforms) {
+			if(pending.node.isAlive())
+				SendTree(pending.node.object(), pending.isCamera, sent);
+		}
+
+		std::unordered_map<ObjectHandle, Pending> vertices;
+		vertices.swap(m_vertices);
+		for(auto& [handle, pending] : vertices) {
+			if(!pending.node.isAlive()) continue;
+			MObject node(pending.node.object());
+			SendVertexChanges(node);
+			m_counts[Vertices].sent++;
+		}
+
+		std::unordered_map<ObjectHandle, Pending> materials;
+		materials.swap(m_materials);
+		for(auto& [handle, pending] : materials) {
+			if(!pending.node.isAlive()) continue;
+			MObject node(pending.node.object());
+			SendMaterial(node);
+			m_counts[Material].sent++;
+		}
+
+		FlushMsg();
+	}
+
+	// Drops the flush callbacks, pending changes are kept for the next flush.
+	void Clear() {
+		if(m_idleCallback) {
+			MMessage::removeCallback(m_idleCallback);
+			m_idleCallback = 0;
+		}
+		if(m_timeCallback) {
+			MMessage::removeCallback(m_timeCallback);
+			m_timeCallback = 0;
+		}
+	}
+
+	void Report() {
+		Print("// Coalesced {0} transform changes into {1} events, {2} vertex changes into {3}, {4} material changes into {5}\n",
+			m_counts[Transform].marked, m_counts[Transform].sent, m_counts[Vertices].marked, m_counts[Vertices].sent,
+			m_counts[Material].marked, m_counts[Material].sent);
+	}
+
+	private:
+
+	enum Kind {Transform, Vertices, Material, KindCount};
+
+	struct Pending {
+		MObjectHandle node;
+		bool isCamera;
+	};
+
+	struct Count {
+		uint64_t marked;
+		uint64_t sent;
+	};
+
+	void Mark(std::unordered_map<ObjectHandle, Pending>& pending, const MObject& node, bool isCamera, Kind kind) {
+		pending[GetHandle(node)] = {MObjectHandle(node), isCamera};
+		m_counts[kind].marked++;
+
+		if(!m_idleCallback)
+			m_idleCallback = MEventMessage::addEventCallback("idle", Idle, this);
+		if(!m_timeCallback)
+			m_timeCallback = MDGMessage::addTimeChangeCallback(TimeChanged, this);
+	}
+
+	void SendTree(const MObject& node, bool isCamera, std::set<ObjectHandle>& sent) {
+		if(sent.insert(GetHandle(node)).second) {
+			SetPos(node, isCamera);
+			m_counts[Transform].sent++;
+		}
+
+		MFnDagNode dNode(node);
+		for(uint32_t i = 0u; i < dNode.childCount(); i++) {
+			MObject nodeChild(dNode.child(i));
+			if(nodeChild.hasFn(MFn::kTransform))
+				SendTree(nodeChild, false, sent);
+		}
+	}
+
+	static void Idle(void* clientData) {
+		((DirtyNodes*)clientData)->Flush();
+	}
+
+	static void TimeChanged(MTime& /*time*/, void* clientData) {
+		((DirtyNodes*)clientData)->Flush();
+	}
+
+	MCallbackId m_idleCallback;
+	MCallbackId m_timeCallback;
+	std::unordered_map<ObjectHandle, Pending> m_transforms;
+	std::unordered_map<ObjectHandle, Pending> m_vertices;
+	std::unordered_map<ObjectHandle, Pending> m_materials;
+	Count m_counts[KindCount];
+};
+
+DirtyNodes dirtyNodes;
+
+
 // Callback functions
 
 void TopologyModified(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData) {
@@ -391,21 +1329,21 @@ void TopologyModified(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& ot
 
 	if(msg & MNodeMessage::AttributeMessage::kAttributeEval) {
 
-		std::vector<Vertex> vertecies;
-		GetMeshData(node, vertecies);
-
-		EventTopologyModified e;
-		memcpy(e.name, dNode.name().asChar(), MStrLength(dNode.name()));
-		e.vertexCount = static_cast<uint32_t>(vertecies.size());
-
-		uint32_t eventSize = sizeof(EventTopologyModified);
-		uint32_t vertSize = sizeof(Vertex) * e.vertexCount;
-		uint32_t fullSize = eventSize + vertSize;
-		char* data = NEW char[fullSize];
-		memcpy(data, &e, eventSize);
-		memcpy(data + sizeof(e), vertecies.data(), vertSize);
-		SendMsg(data, fullSize);
-		delete[] data;
+		IndexedMesh& indexed = GetIndexedMesh(node, true);
+		void* data = ReserveMsg(sizeof(EventTopologyModified) + indexed.DataSize());
+		if(data) {
+			EventTopologyModified* e = new(data) EventTopologyModified();
+			e->handle = GetHandle(node);
+			dirtyNodes.ForgetVertices(e->handle);
+			dirtyVertices.erase(e->handle);
+			e->vertexCount = (uint32_t)indexed.corners.size();
+			e->indexCount = (uint32_t)indexed.indices.size();
+			e->indexSize = indexed.IndexSize();
+			GetMeshData(node, indexed, e + 1);
+			e->layout = indexed.layout;
+			e->bounds = indexed.bounds;
+			CommitMsg(sizeof(EventTopologyModified) + indexed.DataSize());
+		}
 	}
 
 	callbackHandler.RemoveCallback((char*)clientData, "TopologyModified");
@@ -428,33 +1366,117 @@ void PreTopologyModified(MObject& node, void* clientData) {
 	callbackHandler.Append(dNode.name().asChar(), "TopologyModified", MNodeMessage::addAttributeChangedCallback(node, TopologyModified, (void*)dNode.name().asChar()));
 }
 
+void SendAllVertices(MObject& node) {
+	IndexedMesh& indexed = GetIndexedMesh(node);
+	size_t length = sizeof(EventVertexModified) + indexed.layout.VertexSize() * indexed.corners.size();
+	void* data = ReserveMsg(length);
+	if(data) {
+		EventVertexModified* e = new(data) EventVertexModified();
+		e->handle = GetHandle(node);
+		e->vertexCount = (uint32_t)indexed.corners.size();
+
+		if(indexed.layout.encoding == VertexEncoding::Float) {
+			GetVertices(node, indexed, nullptr, e->vertexCount, (Vertex*)(e + 1));
+			FitBounds((const Vertex*)(e + 1), e->vertexCount, indexed.bounds);
+		}
+		else {
+			std::vector<Vertex> vertecies(e->vertexCount);
+			GetVertices(node, indexed, nullptr, e->vertexCount, vertecies.data());
+			WriteMeshVertices(vertecies.data(), indexed, e->vertexCount, e + 1);
+		}
+
+		e->layout = indexed.layout;
+		e->bounds = indexed.bounds;
+		CommitMsg(length);
+	}
+}
+
 void VertexModified(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData) {
-	if(msg & MNodeMessage::AttributeMessage::kAttributeEval) {
-		MObject node(plug.node());
-		MFnDagNode dNode(node);
+	MObject node(plug.node());
+
+	// Remember which points were edited until the mesh is evaluated.
+	if(msg & MNodeMessage::AttributeMessage::kAttributeSet) {
+		MPlug element = plug.isChild() ? plug.parent() : plug;
+		if(element.isElement()) {
+			MString arrayName = element.array().partialName();
+			if(arrayName == "pt" || arrayName == "vt")
+				dirtyVertices[GetHandle(node)].insert(element.logicalIndex());
+		}
+	}
+
+	if(msg & MNodeMessage::AttributeMessage::kAttributeEval)
+		dirtyNodes.MarkVertices(node);
+}
 
-		std::vector<Vertex> vertecies;
-		GetMeshData(node, vertecies);
+// Sends the vertices of the faces edited since the last time, or all of them.
+void SendVertexChanges(MObject& node) {
+	std::set<int> dirty;
+	dirtyVertices[GetHandle(node)].swap(dirty);
 
-		EventVertexModified e;
-		memcpy(e.name, dNode.name().asChar(), MStrLength(dNode.name()));
-		e.vertexCount = static_cast<uint32_t>(vertecies.size());
+	IndexedMesh& indexed = GetIndexedMesh(node);
+	uint32_t vertexCount = (uint32_t)indexed.corners.size();
 
-		uint32_t eventSize = sizeof(EventVertexModified);
-		uint32_t vertSize = sizeof(Vertex) * e.vertexCount;
-		uint32_t fullSize = eventSize + vertSize;
-		char* data = NEW char[fullSize];
-		memcpy(data, &e, eventSize);
-		memcpy(data + sizeof(e), vertecies.data(), vertSize);
-		SendMsg(data, fullSize);
-		delete[] data;
+	// Vertices used by the dirty faces.
+	std::vector<uint32_t> dirtyIndices;
+	for(uint32_t face : GetDirtyFaces(node, dirty)) {
+		if(face >= indexed.faceOffsets.size()) continue;
+
+		uint32_t start = indexed.faceOffsets[face];
+		uint32_t end = (face + 1u < indexed.faceOffsets.size()) ? indexed.faceOffsets[face + 1u] : (uint32_t)indexed.indices.size();
+		dirtyIndices.insert(dirtyIndices.end(), indexed.indices.begin() + start, indexed.indices.begin() + end);
+	}
+
+	std::sort(dirtyIndices.begin(), dirtyIndices.end());
+	dirtyIndices.erase(std::unique(dirtyIndices.begin(), dirtyIndices.end()), dirtyIndices.end());
+
+	// Merge them into runs of the vertex buffer.
+	std::vector<VertexRange> ranges;
+	for(uint32_t i : dirtyIndices) {
+		if(!ranges.empty() && ranges.back().start + ranges.back().count == i)
+			ranges.back().count++;
+		else
+			ranges.push_back({i, 1u});
+	}
+
+	// Unknown edits, edits to most of the mesh and meshes without bounds yet are sent whole.
+	uint32_t deltaCount = (uint32_t)dirtyIndices.size();
+	if(ranges.empty() || deltaCount * 2u > vertexCount || indexed.bounds.radius < 0.f) {
+		SendAllVertices(node);
+		return;
+	}
+
+	std::vector<Vertex> vertecies(deltaCount);
+	GetVertices(node, indexed, dirtyIndices.data(), deltaCount, vertecies.data());
+
+	// Moving outside the quantization bounds needs the whole mesh quantized again.
+	if(indexed.layout.encoding == VertexEncoding::Quantized && !InsideBounds(vertecies.data(), deltaCount, indexed.layout)) {
+		SendAllVertices(node);
+		return;
+	}
+
+	size_t rangeSize = sizeof(VertexRange) * ranges.size();
+	size_t length = sizeof(EventVertexModified) + rangeSize + indexed.layout.VertexSize() * deltaCount;
+	void* data = ReserveMsg(length);
+	if(data) {
+		EventVertexModified* e = new(data) EventVertexModified();
+		GrowBounds(vertecies.data(), deltaCount, indexed.bounds);
+
+		e->handle = GetHandle(node);
+		e->layout = indexed.layout;
+		e->bounds = indexed.bounds;
+		e->vertexCount = vertexCount;
+		e->rangeCount = (uint32_t)ranges.size();
+		memcpy(e + 1, ranges.data(), rangeSize);
+
+		EncodeVertices(vertecies.data(), deltaCount, indexed.layout, (char*)(e + 1) + rangeSize);
+
+		CommitMsg(length);
 	}
 }
 
 void ShaderChanged(MPlug& srcPlug, MPlug& destPlug, bool made, void* clientData) {
 	MObject srcNode(srcPlug.node());
 	MObject destNode(destPlug.node());
-	MFnDependencyNode dSrcNode(srcNode);
 
 	if(srcNode.hasFn(MFn::kMesh) && destNode.hasFn(MFn::kShadingEngine) && made) {
 		MPlug surface = MFnDependencyNode(destNode).findPlug("surfaceShader");
@@ -468,13 +1490,12 @@ void ShaderChanged(MPlug& srcPlug, MPlug& destPlug, bool made, void* clientData)
 		MString textureFilePath;
 		MString normalFilePath;
 		MColor ambientColor;
-		MString shaderName;
 		GetTexture(shader, textureFilePath, normalFilePath);
-		GetShaderData(shader, shaderName, color, ambientColor);
+		GetShaderData(shader, color, ambientColor);
 
 		EventMaterialChanged e;
-		memcpy(e.newName, shaderName.asChar(), MStrLength(shaderName));
-		memcpy(e.meshName, dSrcNode.name().asChar(), MStrLength(dSrcNode.name()));
+		e.shader = GetHandle(shader);
+		e.mesh = GetHandle(srcNode);
 		memcpy(e.textureFilePath, textureFilePath.asChar(), MFileLength(textureFilePath));
 		memcpy(e.normalFilePath, normalFilePath.asChar(), MFileLength(normalFilePath));
 		e.color << color;
@@ -484,27 +1505,26 @@ void ShaderChanged(MPlug& srcPlug, MPlug& destPlug, bool made, void* clientData)
 }
 
 void ShaderModified(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData) {
-	if(msg & MNodeMessage::AttributeMessage::kAttributeSet) {
-		MObject node(plug.node());
-
-		MString name;
-		MString textureFilePath;
-		MString normalFilePath;
-		MColor color;
-		MColor ambientColor;
+	if(msg & MNodeMessage::AttributeMessage::kAttributeSet)
+		dirtyNodes.MarkMaterial(plug.node());
+}
 
-		GetTexture(node, textureFilePath, normalFilePath);
-		GetShaderData(node, name, color, ambientColor);
+void SendMaterial(MObject& node) {
+	MString textureFilePath;
+	MString normalFilePath;
+	MColor color;
+	MColor ambientColor;
 
-		EventMaterialModified e;
-		memcpy(e.name, name.asChar(), MStrLength(name));
-		memcpy(e.textureFilePath, textureFilePath.asChar(), MFileLength(textureFilePath));
-		memcpy(e.normalFilePath, normalFilePath.asChar(), MFileLength(normalFilePath));
-		e.color << color;
-		e.ambientColor << ambientColor;
-		SendMsg(&e, sizeof(e));
-	}
+	GetTexture(node, textureFilePath, normalFilePath);
+	GetShaderData(node, color, ambientColor);
 
+	EventMaterialModified e;
+	e.shader = GetHandle(node);
+	memcpy(e.textureFilePath, textureFilePath.asChar(), MFileLength(textureFilePath));
+	memcpy(e.normalFilePath, normalFilePath.asChar(), MFileLength(normalFilePath));
+	e.color << color;
+	e.ambientColor << ambientColor;
+	BatchMsg(&e, sizeof(e));
 }
 
 void PostNodeAdded(void* clientData) {
@@ -527,32 +1547,22 @@ void PostNodeAdded(void* clientData) {
 	callbackHandler.RemoveCallback(name, "PostNodeAdded");
 }
 
+// The viewer knows nodes by handle, only the callbacks are kept by name.
 void NameChanged(MObject& node, const MString& str, void* clientData) {
 	MFnDependencyNode dNode(node);
-
-	EventNameChanged e;
-	memcpy(e.newName, dNode.name().asChar(), MStrLength(dNode.name()));
-	memcpy(e.previousName, str.asChar(), MStrLength(str));
-	SendMsg(&e, sizeof(e));
-
 	callbackHandler.ChangeNodeName(str.asChar(), dNode.name().asChar());
 }
 
 void ObjectMoved(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData) {
-	if(msg & MNodeMessage::AttributeMessage::kAttributeSet) {
-		bool isCamera = clientData;
-		SetPos(plug.node(), isCamera);
-		UpdateChildrenPos(plug.node());
-	}
+	if(msg & MNodeMessage::AttributeMessage::kAttributeSet)
+		dirtyNodes.MarkTransform(plug.node(), clientData != nullptr);
 }
 
 void NodeRemoved(MObject& node, void* clientData) {
 	MFnDependencyNode dNode(node);
 	if(node.hasFn(MFn::kMesh)) {
 
-		MString shaderName;
-		MColor color;
-		MColor ambientColor;
+		ObjectHandle shaderHandle(0u);
 
 		MObjectArray shaderEngines;
 		MIntArray shaderIndecies;
@@ -565,15 +1575,19 @@ void NodeRemoved(MObject& node, void* clientData) {
 			surface.connectedTo(srcPlugs, true, false);
 			if(srcPlugs.length() > 0u) shader = srcPlugs[0].node();
 
-			GetShaderData(shader, shaderName, color, ambientColor);
+			shaderHandle = GetHandle(shader);
 		}
 
 		EventMeshDeleted e;
-		memcpy(e.name, dNode.name().asChar(), MStrLength(dNode.name()));
-		memcpy(e.shaderName, shaderName.asChar(), MStrLength(shaderName));
+		e.handle = GetHandle(node);
+		e.shader = shaderHandle;
 		SendMsg(&e, sizeof(e));
+
+		indexedMeshes.erase(e.handle);
+		dirtyVertices.erase(e.handle);
 	}
 
+	dirtyNodes.Forget(GetHandle(node));
 	callbackHandler.RemoveAscociatedCallbacks(dNode.name().asChar());
 }
 
@@ -623,6 +1637,15 @@ EXPORT MStatus initializePlugin(MObject obj) {
 
 	Print("// -------------------------Plugin Loaded---------------------------- //\n");
 
+	bool encodingExists(false);
+	int encoding = MGlobal::optionVarIntValue("MayaViewerVertexEncoding", &encodingExists);
+	if(encodingExists && encoding >= 0 && encoding <= (int)VertexEncoding::Quantized)
+		vertexEncoding = (VertexEncoding)encoding;
+
+	bool cornerExists(false);
+	if(MGlobal::optionVarIntValue("MayaViewerCornerExtraction", &cornerExists) && cornerExists)
+		extraction = Extraction::Corner;
+
 	addNodeCallback = MDGMessage::addNodeAddedCallback(NodeAdded);
 	connectionCallback = MDGMessage::addConnectionCallback(ShaderChanged);
 
@@ -640,12 +1663,16 @@ EXPORT MStatus initializePlugin(MObject obj) {
 	SetPos(MFnDagNode(mainCam).parent(0), true);
 
 
+	// The corner path asks Maya for every vertex, so it can only run on the main thread.
+	uint32_t workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+	SceneExporter exporter((extraction == Extraction::Bulk) ? workerCount : 0u);
+
 	MItDependencyNodes it(MFn::kMesh);
 	while(!it.isDone()) {
 		MObject node(it.thisNode());
 		MFnDagNode dNode(node);
 
-		AddMesh(node);
+		exporter.Submit(node);
 		bool want[3]{true};
 		callbackHandler.Append(dNode.name().asChar(), "PreTopologyIDModified", MPolyMessage::addPolyComponentIdChangedCallback(node, want, 3, PreTopologyIDModified, (void*)dNode.name().asChar()));
 		callbackHandler.Append(dNode.name().asChar(), "PreTopologyModified", MPolyMessage::addPolyTopologyChangedCallback(node, PreTopologyModified));
@@ -655,8 +1682,6 @@ EXPORT MStatus initializePlugin(MObject obj) {
 
 		MObject parent(MFnDagNode(node).parent(0));
 		MFnDagNode dParent(parent);
-		SetPos(parent);
-		UpdateChildrenPos(parent);
 
 		if(parent.hasFn(MFn::kTransform)) {
 			callbackHandler.Append(dParent.name().asChar(), "ObjectMoved", MNodeMessage::addAttributeChangedCallback(parent, ObjectMoved));
@@ -664,6 +1689,8 @@ EXPORT MStatus initializePlugin(MObject obj) {
 		}
 		it.next();
 	}
+	exporter.Finish();
+	extractionCounter.Report();
 
 
 	std::function AddShaderModCallBack([](MItDependencyNodes& itShader) {
@@ -704,11 +1731,14 @@ EXPORT MStatus initializePlugin(MObject obj) {
 
 	update = std::thread([&]() {
 		while(!endThread) {
-			Event* event(nullptr);
-			comRefresh.Inject((void**)&event);
+			// Sleeps until the viewer sends something, wakes up now and then to see if the plugin is unloading.
+			if(!comRefresh.WaitForMessage(100u)) continue;
+
+			size_t length(0ull);
+			Event* event = (Event*)comRefresh.Peek(length);
 			if(event) {
 				EventDispatcher refresh(event);
-				Sleep(100);
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
 				refresh.Dispatch<EventRefreshPlugin>([&](EventRefreshPlugin& e) {
 					MGlobal::executeCommandOnIdle(
 						"unloadPlugin \"MayaViewerPlugin.mll\";"
@@ -719,6 +1749,7 @@ EXPORT MStatus initializePlugin(MObject obj) {
 						"loadPlugin \"C:/Users/maffi/Desktop/MayaViewer/bin/Debug-x64/MayaViewerPlugin.mll\";"); 
 						#endif
 				});
+				comRefresh.Release();
 			}
 		}
 	});
@@ -732,12 +1763,15 @@ EXPORT MStatus initializePlugin(MObject obj) {
 EXPORT MStatus uninitializePlugin(MObject obj) {
 	MFnPlugin plugin(obj);
 
+	extractionCounter.Report();
+	dirtyNodes.Report();
 	Print("// ------------------------Plugin Unloaded--------------------------- //\n");
 
 	endThread = true;
 	update.join();
 
 	callbackHandler.RemoveAllCallbacks();
+	dirtyNodes.Clear();
 	MMessage::removeCallback(addNodeCallback);
 	MMessage::removeCallback(connectionCallback);
 
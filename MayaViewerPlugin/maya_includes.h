@@ -3,7 +3,11 @@
 // some definitions for the DLL to play nice with Maya
 //#define NT_PLUGIN
 //#define REQUIRE_IOSTREAM
+#ifdef _WIN32
 #define EXPORT __declspec(dllexport)
+#else
+#define EXPORT __attribute__((visibility("default")))
+#endif
 
 #include <maya/MStreamUtils.h>
 
@@ -50,10 +54,12 @@
 #include <maya/MMessage.h>
 #include <maya/MTimerMessage.h>
 #include <maya/MDGMessage.h>
+#include <maya/MTime.h>
 #include <maya/MEventMessage.h>
 #include <maya/MPolyMessage.h>
 #include <maya/MNodeMessage.h>
 #include <maya/MDagPath.h>
+#include <maya/MObjectHandle.h>
 #include <maya/MDagMessage.h>
 #include <maya/MUiMessage.h>
 #include <maya/MModelMessage.h>
@@ -65,6 +65,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/MathUtil.cpp \
     src/MathUtil.inl \
     src/MathUtilNeon.inl \
+    src/MathUtilSSE.inl \
     src/Matrix.cpp \
     src/Matrix.inl \
     src/Mesh.cpp \
@@ -33,10 +33,13 @@
 namespace gameplay
 {
 
-static std::vector<Bundle*> __bundleCache;
+// Open bundles by the path they were created with.
+static std::unordered_map<std::string, Bundle*> __bundleCache;
+
+extern Properties* getPropertiesFromNamespacePath(Properties* properties, const std::vector<std::string>& namespacePath);
 
 Bundle::Bundle(const char* path) :
-    _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _trackedNodes(NULL)
+    _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _materialProperties(NULL), _trackedNodes(NULL)
 {
 }
 
@@ -45,14 +48,16 @@ Bundle::~Bundle()
     clearLoadSession();
 
     // Remove this Bundle from the cache.
-    std::vector<Bundle*>::iterator itr = std::find(__bundleCache.begin(), __bundleCache.end(), this);
-    if (itr != __bundleCache.end())
+    std::unordered_map<std::string, Bundle*>::iterator itr = __bundleCache.find(_path);
+    if (itr != __bundleCache.end() && itr->second == this)
     {
         __bundleCache.erase(itr);
     }
 
     SAFE_DELETE_ARRAY(_references);
 
+    clearPreload();
+
     if (_stream)
     {
         SAFE_DELETE(_stream);
@@ -173,20 +178,28 @@ Bundle* Bundle::create(const char* path)
     GP_ASSERT(path);
 
     // Search the cache for this bundle.
-    for (size_t i = 0, count = __bundleCache.size(); i < count; ++i)
+    std::unordered_map<std::string, Bundle*>::iterator itr = __bundleCache.find(path);
+    if (itr != __bundleCache.end())
     {
-        Bundle* p = __bundleCache[i];
-        GP_ASSERT(p);
-        if (p->_path == path)
-        {
-            // Found a match
-            p->addRef();
-            return p;
-        }
+        GP_ASSERT(itr->second);
+        itr->second->addRef();
+        return itr->second;
     }
 
-    // Open the bundle.
-    Stream* stream = FileSystem::open(path);
+    Bundle* bundle = open(path);
+    if (bundle)
+    {
+        __bundleCache[bundle->_path] = bundle;
+    }
+    return bundle;
+}
+
+Bundle* Bundle::open(const char* path)
+{
+    GP_ASSERT(path);
+
+    // Open the bundle, mapped so mesh data can be read without copying it.
+    Stream* stream = FileSystem::open(path, FileSystem::READ | FileSystem::MAPPED);
     if (!stream)
     {
         GP_WARN("Failed to open file '%s'.", path);
@@ -250,25 +263,106 @@ Bundle* Bundle::create(const char* path)
     bundle->_references = refs;
     bundle->_stream = stream;
 
+    // Index the refs by id and offset. The first of any duplicates wins, as a scan of the table would find.
+    bundle->_referenceIds.reserve(refCount);
+    bundle->_referenceOffsets.reserve(refCount);
+    for (unsigned int i = 0; i < refCount; ++i)
+    {
+        bundle->_referenceIds.insert(std::make_pair(refs[i].id, &refs[i]));
+        bundle->_referenceOffsets.insert(std::make_pair(refs[i].offset, &refs[i]));
+    }
+
     return bundle;
 }
 
-Bundle::Reference* Bundle::find(const char* id) const
+Bundle* Bundle::addToCache(Bundle* bundle)
+{
+    GP_ASSERT(bundle);
+
+    std::unordered_map<std::string, Bundle*>::iterator itr = __bundleCache.find(bundle->_path);
+    if (itr == __bundleCache.end())
+    {
+        __bundleCache[bundle->_path] = bundle;
+        return bundle;
+    }
+
+    // Hand the preloaded data to the cached bundle, keeping any it already has.
+    Bundle* cached = itr->second;
+    GP_ASSERT(cached);
+    for (std::unordered_map<std::string, MeshData*>::iterator mesh = bundle->_preloadedMeshes.begin(); mesh != bundle->_preloadedMeshes.end(); ++mesh)
+    {
+        if (!cached->_preloadedMeshes.insert(*mesh).second)
+        {
+            SAFE_DELETE(mesh->second);
+        }
+    }
+    bundle->_preloadedMeshes.clear();
+    if (!cached->_materialProperties)
+    {
+        cached->_materialProperties = bundle->_materialProperties;
+        bundle->_materialProperties = NULL;
+    }
+
+    cached->addRef();
+    SAFE_RELEASE(bundle);
+    return cached;
+}
+
+void Bundle::preload(const std::function<void(unsigned int, unsigned int)>& progress)
 {
-    GP_ASSERT(id);
     GP_ASSERT(_references);
 
-    // Search the ref table for the given id (case-sensitive).
+    unsigned int meshCount = 0;
     for (unsigned int i = 0; i < _referenceCount; ++i)
     {
-        if (_references[i].id == id)
+        if (_references[i].type == BUNDLE_TYPE_MESH)
+            ++meshCount;
+    }
+
+    // Mesh data is copied out of the mapped file, so its pages are read here rather than during upload.
+    unsigned int meshesRead = 0;
+    for (unsigned int i = 0; i < _referenceCount; ++i)
+    {
+        Reference* ref = &_references[i];
+        if (ref->type != BUNDLE_TYPE_MESH || _preloadedMeshes.count(ref->id))
+            continue;
+
+        if (seekTo(ref->id.c_str(), BUNDLE_TYPE_MESH))
         {
-            // Found a match
-            return &_references[i];
+            MeshData* meshData = readMeshData();
+            if (meshData)
+                _preloadedMeshes[ref->id] = meshData;
         }
+
+        if (progress)
+            progress(++meshesRead, meshCount);
     }
 
-    return NULL;
+    const std::string& materialPath = getMaterialPath();
+    if (!_materialProperties && !materialPath.empty())
+    {
+        _materialProperties = Properties::create(materialPath.c_str());
+    }
+}
+
+void Bundle::clearPreload()
+{
+    for (std::unordered_map<std::string, MeshData*>::iterator itr = _preloadedMeshes.begin(); itr != _preloadedMeshes.end(); ++itr)
+    {
+        SAFE_DELETE(itr->second);
+    }
+    _preloadedMeshes.clear();
+    SAFE_DELETE(_materialProperties);
+}
+
+Bundle::Reference* Bundle::find(const char* id) const
+{
+    GP_ASSERT(id);
+    GP_ASSERT(_references);
+
+    // Look up the ref table for the given id (case-sensitive).
+    std::unordered_map<std::string, Reference*>::const_iterator itr = _referenceIds.find(id);
+    return itr != _referenceIds.end() ? itr->second : NULL;
 }
 
 void Bundle::clearLoadSession()
@@ -288,16 +382,14 @@ const char* Bundle::getIdFromOffset() const
 
 const char* Bundle::getIdFromOffset(unsigned int offset) const
 {
-    // Search the ref table for the given offset.
+    // Look up the ref table for the given offset.
     if (offset > 0)
     {
         GP_ASSERT(_references);
-        for (unsigned int i = 0; i < _referenceCount; ++i)
+        std::unordered_map<unsigned int, Reference*>::const_iterator itr = _referenceOffsets.find(offset);
+        if (itr != _referenceOffsets.end() && itr->second->id.length() > 0)
         {
-            if (_references[i].offset == offset && _references[i].id.length() > 0)
-            {
-                return _references[i].id.c_str();
-            }
+            return itr->second->id.c_str();
         }
     }
     return NULL;
@@ -1011,9 +1103,21 @@ Model* Bundle::readModel(const char* nodeId)
                     std::string materialPath = getMaterialPath();
                     if (materialPath.length() > 0)
                     {
-                        materialPath.append("#");
-                        materialPath.append(materialName);
-                        Material* material = Material::create(materialPath.c_str());
+                        // Use the material file parsed by preload() rather than parsing it for each model.
+                        Material* material = NULL;
+                        if (_materialProperties)
+                        {
+                            std::vector<std::string> namespacePath(1, materialName);
+                            Properties* materialProperties = getPropertiesFromNamespacePath(_materialProperties, namespacePath);
+                            if (materialProperties)
+                                material = Material::create(materialProperties);
+                        }
+                        else
+                        {
+                            materialPath.append("#");
+                            materialPath.append(materialName);
+                            material = Material::create(materialPath.c_str());
+                        }
                         if (material)
                         {
                             int partIndex = model->getMesh()->getPartCount() > 0 ? i : -1;
@@ -1375,20 +1479,31 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
         return NULL;
     }
 
-    // Seek to the specified mesh.
-    Reference* ref = seekTo(id, BUNDLE_TYPE_MESH);
-    if (ref == NULL)
+    // Take the mesh data if it was preloaded.
+    MeshData* meshData = NULL;
+    std::unordered_map<std::string, MeshData*>::iterator preloaded = _preloadedMeshes.find(id);
+    if (preloaded != _preloadedMeshes.end())
     {
-        GP_ERROR("Failed to locate ref for mesh '%s'.", id);
-        return NULL;
+        meshData = preloaded->second;
+        _preloadedMeshes.erase(preloaded);
     }
-
-    // Read mesh data.
-    MeshData* meshData = readMeshData();
-    if (meshData == NULL)
+    else
     {
-        GP_ERROR("Failed to load mesh data for mesh '%s'.", id);
-        return NULL;
+        // Seek to the specified mesh.
+        Reference* ref = seekTo(id, BUNDLE_TYPE_MESH);
+        if (ref == NULL)
+        {
+            GP_ERROR("Failed to locate ref for mesh '%s'.", id);
+            return NULL;
+        }
+
+        // Read mesh data, in place when the bundle is mapped since it is uploaded before this returns.
+        meshData = readMeshData(true);
+        if (meshData == NULL)
+        {
+            GP_ERROR("Failed to load mesh data for mesh '%s'.", id);
+            return NULL;
+        }
     }
 
     // Create mesh.
@@ -1437,7 +1552,7 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     return mesh;
 }
 
-Bundle::MeshData* Bundle::readMeshData()
+Bundle::MeshData* Bundle::readMeshData(bool inPlace)
 {
     // Read vertex format/elements.
     unsigned int vertexElementCount;
@@ -1493,12 +1608,21 @@ Bundle::MeshData* Bundle::readMeshData()
 
     GP_ASSERT(meshData->vertexFormat.getVertexSize());
     meshData->vertexCount = vertexByteCount / meshData->vertexFormat.getVertexSize();
-    meshData->vertexData = new unsigned char[vertexByteCount];
-    if (_stream->read(meshData->vertexData, 1, vertexByteCount) != vertexByteCount)
+    const void* mappedVertexData = inPlace ? _stream->readInPlace(vertexByteCount) : NULL;
+    if (mappedVertexData)
     {
-        GP_ERROR("Failed to load vertex data.");
-        SAFE_DELETE(meshData);
-        return NULL;
+        meshData->vertexData = (unsigned char*)mappedVertexData;
+        meshData->vertexDataMapped = true;
+    }
+    else
+    {
+        meshData->vertexData = new unsigned char[vertexByteCount];
+        if (_stream->read(meshData->vertexData, 1, vertexByteCount) != vertexByteCount)
+        {
+            GP_ERROR("Failed to load vertex data.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
     }
 
     // Read mesh bounds (bounding box and bounding sphere).
@@ -1572,12 +1696,21 @@ Bundle::MeshData* Bundle::readMeshData()
         GP_ASSERT(indexSize);
         partData->indexCount = iByteCount / indexSize;
 
-        partData->indexData = new unsigned char[iByteCount];
-        if (_stream->read(partData->indexData, 1, iByteCount) != iByteCount)
+        const void* mappedIndexData = inPlace ? _stream->readInPlace(iByteCount) : NULL;
+        if (mappedIndexData)
         {
-            GP_ERROR("Failed to read index data for mesh part with index %d.", i);
-            SAFE_DELETE(meshData);
-            return NULL;
+            partData->indexData = (unsigned char*)mappedIndexData;
+            partData->indexDataMapped = true;
+        }
+        else
+        {
+            partData->indexData = new unsigned char[iByteCount];
+            if (_stream->read(partData->indexData, 1, iByteCount) != iByteCount)
+            {
+                GP_ERROR("Failed to read index data for mesh part with index %d.", i);
+                SAFE_DELETE(meshData);
+                return NULL;
+            }
         }
     }
 
@@ -1615,17 +1748,22 @@ Bundle::MeshData* Bundle::readMeshData(const char* url)
         return NULL;
     }
 
+    // The bundle may be shared with a load in progress, so its file position is put back after.
+    long position = bundle->_stream->position();
+
     // Seek to mesh with specified ID in bundle.
     Reference* ref = bundle->seekTo(id.c_str(), BUNDLE_TYPE_MESH);
     if (ref == NULL)
     {
         GP_ERROR("Failed to load ref from bundle '%s' for mesh with id '%s'.", file.c_str(), id.c_str());
+        SAFE_RELEASE(bundle);
         return NULL;
     }
 
-    // Read mesh data from current file position.
+    // Read mesh data from current file position. It is copied, since it outlives the bundle.
     MeshData* meshData = bundle->readMeshData();
 
+    bundle->_stream->seek(position, SEEK_SET);
     SAFE_RELEASE(bundle);
 
     return meshData;
@@ -1871,23 +2009,29 @@ Bundle::Reference::~Reference()
 }
 
 Bundle::MeshPartData::MeshPartData() :
-		primitiveType(Mesh::TRIANGLES), indexFormat(Mesh::INDEX32), indexCount(0), indexData(NULL)
+		primitiveType(Mesh::TRIANGLES), indexFormat(Mesh::INDEX32), indexCount(0), indexData(NULL), indexDataMapped(false)
 {
 }
 
 Bundle::MeshPartData::~MeshPartData()
 {
-    SAFE_DELETE_ARRAY(indexData);
+    if (!indexDataMapped)
+    {
+        SAFE_DELETE_ARRAY(indexData);
+    }
 }
 
 Bundle::MeshData::MeshData(const VertexFormat& vertexFormat)
-    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), primitiveType(Mesh::TRIANGLES)
+    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), vertexDataMapped(false), primitiveType(Mesh::TRIANGLES)
 {
 }
 
 Bundle::MeshData::~MeshData()
 {
-    SAFE_DELETE_ARRAY(vertexData);
+    if (!vertexDataMapped)
+    {
+        SAFE_DELETE_ARRAY(vertexData);
+    }
 
     for (unsigned int i = 0; i < parts.size(); ++i)
     {
@@ -150,6 +150,7 @@ private:
         Mesh::IndexFormat indexFormat;
         unsigned int indexCount;
         unsigned char* indexData;
+        bool indexDataMapped; // indexData points into the bundle's mapped file and isn't deleted.
     };
 
     struct MeshData
@@ -160,6 +161,7 @@ private:
         VertexFormat vertexFormat;
         unsigned int vertexCount;
         unsigned char* vertexData;
+        bool vertexDataMapped; // vertexData points into the bundle's mapped file and isn't deleted.
         BoundingBox boundingBox;
         BoundingSphere boundingSphere;
         Mesh::PrimitiveType primitiveType;
@@ -178,6 +180,38 @@ private:
      */
     Bundle& operator=(const Bundle&);
 
+    /**
+     * Opens the bundle at the given path without looking in or adding to the bundle cache.
+     *
+     * @param path The path of the bundle file.
+     *
+     * @return The new Bundle or NULL if there was an error.
+     */
+    static Bundle* open(const char* path);
+
+    /**
+     * Adds a bundle made by open() to the cache. If a bundle for the same path was cached
+     * meanwhile, the preloaded data moves to that one and it is returned in place of the given one.
+     *
+     * @param bundle The bundle to cache, its reference is passed on to the returned bundle.
+     *
+     * @return The cached bundle.
+     */
+    static Bundle* addToCache(Bundle* bundle);
+
+    /**
+     * Reads all mesh data and parses the default material file ahead of loading.
+     * Only touches this bundle, so it can run on a worker thread before the bundle is cached.
+     *
+     * @param progress Called with the number of meshes read so far and the number of meshes.
+     */
+    void preload(const std::function<void(unsigned int, unsigned int)>& progress);
+
+    /**
+     * Frees whatever preload() read that loading didn't use.
+     */
+    void clearPreload();
+
     /**
      * Finds a reference by ID.
      */
@@ -197,7 +231,7 @@ private:
     const char* getIdFromOffset() const;
 
     /**
-     * Returns the ID of the object at the given file offset by searching through the reference table.
+     * Returns the ID of the object at the given file offset by looking it up in the reference table.
      * Returns NULL if not found.
      *
      * @param offset The file offset.
@@ -365,8 +399,11 @@ private:
 
     /**
      * Reads mesh data from the current file position.
+     *
+     * @param inPlace True to point the vertex and index data into the bundle's stream when it is
+     *        mapped, instead of copying them. That data is only valid while the bundle is open.
      */
-    MeshData* readMeshData();
+    MeshData* readMeshData(bool inPlace = false);
 
     /**
      * Reads mesh data for the specified URL.
@@ -455,7 +492,11 @@ private:
     std::string _materialPath;
     unsigned int _referenceCount;
     Reference* _references;
+    std::unordered_map<std::string, Reference*> _referenceIds;
+    std::unordered_map<unsigned int, Reference*> _referenceOffsets;
     Stream* _stream;
+    std::unordered_map<std::string, MeshData*> _preloadedMeshes;
+    Properties* _materialProperties;
 
     std::vector<MeshSkinData*> _meshSkins;
     std::map<std::string, Node*>* _trackedNodes;
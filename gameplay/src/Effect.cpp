@@ -226,11 +226,280 @@ static void writeShaderToErrorFile(const char* filePath, const char* source)
     }
 }
 
-Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines)
+// Programs the driver linked before, read from the file named by graphics.shaderCachePath.
+// The file starts with the driver the programs were linked by and is dropped when that changes.
+// Entries are appended as new programs get linked, a later entry for a key replaces an earlier one.
+// Each entry carries the session it was last used in, a hit appends a small touch record for that.
+// Loading evicts the entries the last session didn't use and compacts the file when anything was
+// evicted or replaced, so programs of old shader sources don't pile up.
+struct ProgramBinary
+{
+    GLenum format;
+    unsigned int session;
+    std::vector<char> data;
+};
+
+struct ProgramBinaryFileHeader
+{
+    char magic[4];
+    unsigned int version;
+    unsigned int session;
+    unsigned int driverLength;
+};
+
+// Leads every entry, a touch record has no data and a format of 0.
+struct ProgramBinaryEntryHeader
+{
+    unsigned long long key;
+    unsigned int format;
+    unsigned int length;
+    unsigned int session;
+    unsigned int padding;
+};
+
+static const char __programBinaryMagic[4] = { 'G', 'P', 'S', 'C' };
+static const unsigned int __programBinaryVersion = 2;
+
+static bool __programBinariesLoaded = false;
+static bool __programBinaries = false;
+static std::string __programBinaryPath;
+static std::string __programBinaryDriver;
+static unsigned int __programBinarySession = 0;
+static std::unordered_map<unsigned long long, ProgramBinary> __programBinaryCache;
+static unsigned int __programBinaryHits = 0;
+static unsigned int __programBinaryMisses = 0;
+
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+static void writeProgramBinaryHeader(FILE* file)
+{
+    ProgramBinaryFileHeader header;
+    memcpy(header.magic, __programBinaryMagic, sizeof(header.magic));
+    header.version = __programBinaryVersion;
+    header.session = __programBinarySession;
+    header.driverLength = (unsigned int)__programBinaryDriver.size();
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(__programBinaryDriver.data(), 1, __programBinaryDriver.size(), file);
+}
+
+static void writeProgramBinary(FILE* file, unsigned long long key, const ProgramBinary* binary, unsigned int session)
+{
+    ProgramBinaryEntryHeader header = { key, binary ? (unsigned int)binary->format : 0u, binary ? (unsigned int)binary->data.size() : 0u, session, 0u };
+    fwrite(&header, sizeof(header), 1, file);
+    if (binary)
+        fwrite(binary->data.data(), 1, binary->data.size(), file);
+}
+
+// Appends one entry, or a touch record when binary is NULL.
+static void appendProgramBinary(unsigned long long key, const ProgramBinary* binary)
+{
+    FILE* file = FileSystem::openFile(__programBinaryPath.c_str(), "ab");
+    if (file == NULL)
+    {
+        GP_WARN("Failed to open shader cache '%s' for writing.", __programBinaryPath.c_str());
+        __programBinaries = false;
+        return;
+    }
+    writeProgramBinary(file, key, binary, __programBinarySession);
+    fclose(file);
+}
+
+// Reads the entries of a file written for the current driver, returns false if it was for another one.
+static bool readProgramBinaries(Stream* stream, size_t& records, size_t& touches, bool& truncated)
 {
-    GP_ASSERT(vshSource);
-    GP_ASSERT(fshSource);
+    ProgramBinaryFileHeader header;
+    if (stream->read(&header, sizeof(header), 1) != 1 || memcmp(header.magic, __programBinaryMagic, sizeof(header.magic)) != 0 ||
+        header.version != __programBinaryVersion || header.driverLength != __programBinaryDriver.size())
+        return false;
+
+    std::string driver(header.driverLength, '\0');
+    if (header.driverLength && stream->read(&driver[0], 1, header.driverLength) != header.driverLength)
+        return false;
+    if (driver != __programBinaryDriver)
+        return false;
+    __programBinarySession = header.session + 1;
+
+    ProgramBinaryEntryHeader entry;
+    while (stream->read(&entry, sizeof(entry), 1) == 1)
+    {
+        ++records;
+        if (entry.length == 0)
+        {
+            ++touches;
+            std::unordered_map<unsigned long long, ProgramBinary>::iterator itr = __programBinaryCache.find(entry.key);
+            if (itr != __programBinaryCache.end())
+                itr->second.session = entry.session;
+            continue;
+        }
+
+        ProgramBinary& binary = __programBinaryCache[entry.key];
+        binary.format = entry.format;
+        binary.session = entry.session;
+        binary.data.resize(entry.length);
+        if (stream->read(binary.data.data(), 1, entry.length) != entry.length)
+        {
+            // Cut short, likely a crash while writing. Drop the rest.
+            __programBinaryCache.erase(entry.key);
+            truncated = true;
+            break;
+        }
+    }
+    return true;
+}
+#endif
+
+static void loadProgramBinaries()
+{
+    __programBinariesLoaded = true;
+
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    Properties* graphicsConfig = Game::getInstance()->getConfig()->getNamespace("graphics", true);
+    if (graphicsConfig && !graphicsConfig->getBool("shaderCache", true))
+        return;
+
+    // Drivers without any binary format can't save programs. Older contexts don't know the query, so ignore its error.
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    glGetError();
+    if (formatCount <= 0)
+        return;
+
+    __programBinaries = true;
+    __programBinaryPath = graphicsConfig ? graphicsConfig->getString("shaderCachePath", "shaders.cache") : "shaders.cache";
+
+    // The driver decides if an old binary still loads.
+    GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (size_t i = 0; i < sizeof(driverStrings) / sizeof(driverStrings[0]); ++i)
+    {
+        const char* driver = (const char*)glGetString(driverStrings[i]);
+        __programBinaryDriver += driver ? driver : "";
+        __programBinaryDriver += '\n';
+    }
+
+    size_t records = 0;
+    size_t touches = 0;
+    bool truncated = false;
+    bool current = false;
+    __programBinarySession = 0;
+    std::unique_ptr<Stream> stream(FileSystem::open(__programBinaryPath.c_str()));
+    if (stream.get() && stream->canRead())
+        current = readProgramBinaries(stream.get(), records, touches, truncated);
+    stream.reset();
+
+    if (!current)
+        __programBinaryCache.clear();
+
+    // Keep what the last session linked or loaded.
+    size_t evicted = 0;
+    for (std::unordered_map<unsigned long long, ProgramBinary>::iterator itr = __programBinaryCache.begin(); itr != __programBinaryCache.end(); )
+    {
+        if (itr->second.session + 1 < __programBinarySession)
+        {
+            itr = __programBinaryCache.erase(itr);
+            ++evicted;
+        }
+        else
+            ++itr;
+    }
+
+    // Only the session in the header changes while the file holds nothing stale.
+    bool compact = !current || truncated || evicted || records - touches != __programBinaryCache.size() + evicted || touches > __programBinaryCache.size();
+    FILE* file = FileSystem::openFile(__programBinaryPath.c_str(), compact ? "wb" : "r+b");
+    if (file == NULL)
+    {
+        GP_WARN("Failed to open shader cache '%s' for writing.", __programBinaryPath.c_str());
+        __programBinaries = false;
+        return;
+    }
+    writeProgramBinaryHeader(file);
+    if (compact)
+    {
+        for (std::unordered_map<unsigned long long, ProgramBinary>::const_iterator itr = __programBinaryCache.begin(); itr != __programBinaryCache.end(); ++itr)
+            writeProgramBinary(file, itr->first, &itr->second, itr->second.session);
+    }
+    fclose(file);
+#endif
+}
+
+// FNV-1a over the defines and the expanded sources. The driver is checked by the cache file header.
+static unsigned long long hashProgramSource(const std::string& defines, const char* vshSource, const char* fshSource)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    const char* parts[] = { defines.c_str(), vshSource, fshSource };
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); ++i)
+    {
+        // Include the terminator so moving text from one part to the next changes the hash.
+        for (const unsigned char* c = (const unsigned char*)(parts[i] ? parts[i] : ""); ; ++c)
+        {
+            hash = (hash ^ *c) * 1099511628211ull;
+            if (*c == '\0')
+                break;
+        }
+    }
+    return hash;
+}
+
+// The linked program for key, or 0 if there is none or the driver rejected it.
+static GLuint loadProgramBinary(unsigned long long key)
+{
+    if (!__programBinariesLoaded)
+        loadProgramBinaries();
+
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    std::unordered_map<unsigned long long, ProgramBinary>::iterator itr = __programBinaryCache.find(key);
+    if (itr == __programBinaryCache.end())
+        return 0;
+
+    GLuint program;
+    GLint success;
+    GL_ASSERT( program = glCreateProgram() );
+    glProgramBinary(program, itr->second.format, itr->second.data.data(), (GLsizei)itr->second.data.size());
+    glGetError();
+    GL_ASSERT( glGetProgramiv(program, GL_LINK_STATUS, &success) );
+    if (success != GL_TRUE)
+    {
+        __programBinaryCache.erase(itr);
+        GL_ASSERT( glDeleteProgram(program) );
+        return 0;
+    }
+
+    // Marks it used, once per session.
+    if (itr->second.session != __programBinarySession && __programBinaries)
+    {
+        itr->second.session = __programBinarySession;
+        appendProgramBinary(key, NULL);
+    }
+    return program;
+#else
+    return 0;
+#endif
+}
+
+// Appends the binary of a newly linked program to the cache file.
+static void saveProgramBinary(unsigned long long key, GLuint program)
+{
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    if (!__programBinaries)
+        return;
+
+    GLint length = 0;
+    GL_ASSERT( glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length) );
+    if (length <= 0)
+        return;
+
+    ProgramBinary& binary = __programBinaryCache[key];
+    binary.session = __programBinarySession;
+    binary.data.resize(length);
+    GL_ASSERT( glGetProgramBinary(program, length, &length, &binary.format, binary.data.data()) );
+    binary.data.resize(length);
+
+    appendProgramBinary(key, &binary);
+#endif
+}
 
+// Compiles and links the expanded sources, 0 if that failed.
+static GLuint compileProgram(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource,
+                             const std::string& definesStr, const char* vshExpanded, const char* fshExpanded)
+{
     const unsigned int SHADER_SOURCE_LENGTH = 3;
     const GLchar* shaderSource[SHADER_SOURCE_LENGTH];
     char* infoLog = NULL;
@@ -240,21 +509,9 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
     GLint length;
     GLint success;
 
-    // Replace all comma separated definitions with #define prefix and \n suffix
-    std::string definesStr = "";
-    replaceDefines(defines, definesStr);
-    
     shaderSource[0] = definesStr.c_str();
     shaderSource[1] = "\n";
-    std::string vshSourceStr = "";
-    if (vshPath)
-    {
-        // Replace the #include "xxxxx.xxx" with the sources that come from file paths
-        replaceIncludes(vshPath, vshSource, vshSourceStr);
-        if (vshSource && strlen(vshSource) != 0)
-            vshSourceStr += "\n";
-    }
-    shaderSource[2] = vshPath ? vshSourceStr.c_str() :  vshSource;
+    shaderSource[2] = vshExpanded;
     GL_ASSERT( vertexShader = glCreateShader(GL_VERTEX_SHADER) );
     GL_ASSERT( glShaderSource(vertexShader, SHADER_SOURCE_LENGTH, shaderSource, NULL) );
     GL_ASSERT( glCompileShader(vertexShader) );
@@ -283,19 +540,11 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
         // Clean up.
         GL_ASSERT( glDeleteShader(vertexShader) );
 
-        return NULL;
+        return 0;
     }
 
     // Compile the fragment shader.
-    std::string fshSourceStr;
-    if (fshPath)
-    {
-        // Replace the #include "xxxxx.xxx" with the sources that come from file paths
-        replaceIncludes(fshPath, fshSource, fshSourceStr);
-        if (fshSource && strlen(fshSource) != 0)
-            fshSourceStr += "\n";
-    }
-    shaderSource[2] = fshPath ? fshSourceStr.c_str() : fshSource;
+    shaderSource[2] = fshExpanded;
     GL_ASSERT( fragmentShader = glCreateShader(GL_FRAGMENT_SHADER) );
     GL_ASSERT( glShaderSource(fragmentShader, SHADER_SOURCE_LENGTH, shaderSource, NULL) );
     GL_ASSERT( glCompileShader(fragmentShader) );
@@ -325,13 +574,17 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
         GL_ASSERT( glDeleteShader(vertexShader) );
         GL_ASSERT( glDeleteShader(fragmentShader) );
 
-        return NULL;
+        return 0;
     }
 
     // Link program.
     GL_ASSERT( program = glCreateProgram() );
     GL_ASSERT( glAttachShader(program, vertexShader) );
     GL_ASSERT( glAttachShader(program, fragmentShader) );
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    if (__programBinaries)
+        GL_ASSERT( glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE) );
+#endif
     GL_ASSERT( glLinkProgram(program) );
     GL_ASSERT( glGetProgramiv(program, GL_LINK_STATUS, &success) );
 
@@ -359,7 +612,60 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
         // Clean up.
         GL_ASSERT( glDeleteProgram(program) );
 
-        return NULL;
+        return 0;
+    }
+
+    return program;
+}
+
+Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines)
+{
+    GP_ASSERT(vshSource);
+    GP_ASSERT(fshSource);
+
+    GLint length;
+
+    // Replace all comma separated definitions with #define prefix and \n suffix
+    std::string definesStr = "";
+    replaceDefines(defines, definesStr);
+
+    std::string vshSourceStr = "";
+    if (vshPath)
+    {
+        // Replace the #include "xxxxx.xxx" with the sources that come from file paths
+        replaceIncludes(vshPath, vshSource, vshSourceStr);
+        if (vshSource && strlen(vshSource) != 0)
+            vshSourceStr += "\n";
+    }
+    std::string fshSourceStr = "";
+    if (fshPath)
+    {
+        replaceIncludes(fshPath, fshSource, fshSourceStr);
+        if (fshSource && strlen(fshSource) != 0)
+            fshSourceStr += "\n";
+    }
+    const char* vshExpanded = vshPath ? vshSourceStr.c_str() : vshSource;
+    const char* fshExpanded = fshPath ? fshSourceStr.c_str() : fshSource;
+
+    // Reuse the program the driver built last time for exactly these sources.
+    unsigned long long key = hashProgramSource(definesStr, vshExpanded, fshExpanded);
+    GLuint program = loadProgramBinary(key);
+    bool cached = program != 0;
+    if (!cached)
+    {
+        program = compileProgram(vshPath, vshSource, fshPath, fshSource, definesStr, vshExpanded, fshExpanded);
+        if (!program)
+            return NULL;
+        saveProgramBinary(key, program);
+    }
+    if (__programBinaries)
+    {
+        if (cached)
+            ++__programBinaryHits;
+        else
+            ++__programBinaryMisses;
+        Logger::log(Logger::LEVEL_INFO, "Shader cache %s for (%s,%s), %u hits and %u misses so far.\n", cached ? "hit" : "miss",
+            vshPath == NULL ? "NULL" : vshPath, fshPath == NULL ? "NULL" : fshPath, __programBinaryHits, __programBinaryMisses);
     }
 
     // Create and return the new Effect.
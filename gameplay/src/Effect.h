@@ -30,6 +30,11 @@ public:
     /**
      * Creates an effect using the specified vertex and fragment shader.
      *
+     * Linked programs are saved to the file named by graphics.shaderCachePath in the game
+     * config (shaders.cache by default), so later runs load them without compiling. Programs
+     * a run doesn't use are dropped from it by the next run, and the whole file is dropped when
+     * the driver changes. Set graphics.shaderCache to false to turn this off.
+     *
      * @param vshPath The path to the vertex shader file.
      * @param fshPath The path to the fragment shader file.
      * @param defines A new-line delimited list of preprocessor defines. May be NULL.
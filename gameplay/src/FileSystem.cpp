@@ -18,6 +18,9 @@
     #define __EXT_POSIX2
     #include <libgen.h>
     #include <dirent.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
     #define gp_stat stat
     #define gp_stat_struct struct stat
 #endif
@@ -145,6 +148,46 @@ private:
     bool _canWrite;
 };
 
+#ifndef __ANDROID__
+
+/**
+ * A read-only file mapped into memory.
+ *
+ * @script{ignore}
+ */
+class MappedFileStream : public Stream
+{
+public:
+    friend class FileSystem;
+
+    ~MappedFileStream();
+    virtual bool canRead();
+    virtual bool canWrite();
+    virtual bool canSeek();
+    virtual void close();
+    virtual size_t read(void* ptr, size_t size, size_t count);
+    virtual const void* readInPlace(size_t size);
+    virtual char* readLine(char* str, int num);
+    virtual size_t write(const void* ptr, size_t size, size_t count);
+    virtual bool eof();
+    virtual size_t length();
+    virtual long int position();
+    virtual bool seek(long int offset, int origin);
+    virtual bool rewind();
+
+    static MappedFileStream* create(const char* filePath);
+
+private:
+    MappedFileStream(const unsigned char* data, size_t length);
+
+private:
+    const unsigned char* _data;
+    size_t _length;
+    size_t _position;
+};
+
+#endif
+
 #ifdef __ANDROID__
 
 /**
@@ -363,6 +406,19 @@ bool FileSystem::fileExists(const char* filePath)
 
 }
 
+time_t FileSystem::getModifiedTime(const char* filePath)
+{
+    GP_ASSERT(filePath);
+
+    std::string fullPath;
+    getFullPath(filePath, fullPath);
+
+    gp_stat_struct s;
+    if (stat(fullPath.c_str(), &s) != 0)
+        return 0;
+    return s.st_mtime;
+}
+
 Stream* FileSystem::open(const char* path, size_t streamMode)
 {
     char modeStr[] = "rb";
@@ -404,6 +460,15 @@ Stream* FileSystem::open(const char* path, size_t streamMode)
 #else
     std::string fullPath;
     getFullPath(path, fullPath);
+
+    // Files that can't be mapped, such as empty ones, are read through a FileStream.
+    if ((streamMode & MAPPED) != 0 && (streamMode & WRITE) == 0)
+    {
+        MappedFileStream* stream = MappedFileStream::create(fullPath.c_str());
+        if (stream)
+            return stream;
+    }
+
     FileStream* stream = FileStream::create(fullPath.c_str(), modeStr);
     return stream;
 #endif
@@ -717,6 +782,192 @@ bool FileStream::rewind()
 
 ////////////////////////////////
 
+#ifndef __ANDROID__
+
+MappedFileStream::MappedFileStream(const unsigned char* data, size_t length)
+    : _data(data), _length(length), _position(0)
+{
+}
+
+MappedFileStream::~MappedFileStream()
+{
+    if (_data)
+    {
+        close();
+    }
+}
+
+MappedFileStream* MappedFileStream::create(const char* filePath)
+{
+    // The file and mapping handles can be closed once the view exists, it keeps the mapping alive.
+#ifdef WIN32
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return NULL;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL)
+        return NULL;
+
+    return new MappedFileStream((const unsigned char*)data, (size_t)size.QuadPart);
+#else
+    int file = ::open(filePath, O_RDONLY);
+    if (file < 0)
+        return NULL;
+
+    gp_stat_struct s;
+    if (fstat(file, &s) != 0 || s.st_size <= 0)
+    {
+        ::close(file);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    return new MappedFileStream((const unsigned char*)data, (size_t)s.st_size);
+#endif
+}
+
+bool MappedFileStream::canRead()
+{
+    return _data != NULL;
+}
+
+bool MappedFileStream::canWrite()
+{
+    return false;
+}
+
+bool MappedFileStream::canSeek()
+{
+    return _data != NULL;
+}
+
+void MappedFileStream::close()
+{
+    if (_data)
+    {
+#ifdef WIN32
+        UnmapViewOfFile(_data);
+#else
+        munmap((void*)_data, _length);
+#endif
+    }
+    _data = NULL;
+    _length = 0;
+    _position = 0;
+}
+
+size_t MappedFileStream::read(void* ptr, size_t size, size_t count)
+{
+    if (!_data || size == 0 || _position >= _length)
+        return 0;
+
+    count = std::min(count, (_length - _position) / size);
+    memcpy(ptr, _data + _position, size * count);
+    _position += size * count;
+    return count;
+}
+
+const void* MappedFileStream::readInPlace(size_t size)
+{
+    if (!_data || _position > _length || size > _length - _position)
+        return NULL;
+
+    const unsigned char* data = _data + _position;
+    _position += size;
+    return data;
+}
+
+char* MappedFileStream::readLine(char* str, int num)
+{
+    // Stops after a newline or num - 1 characters, as fgets does.
+    if (!_data || num <= 0 || _position >= _length)
+        return NULL;
+
+    int i = 0;
+    while (i < num - 1 && _position < _length)
+    {
+        char c = (char)_data[_position++];
+        str[i++] = c;
+        if (c == '\n')
+            break;
+    }
+    str[i] = '\0';
+    return str;
+}
+
+size_t MappedFileStream::write(const void* /*ptr*/, size_t /*size*/, size_t /*count*/)
+{
+    return 0;
+}
+
+bool MappedFileStream::eof()
+{
+    return _position >= _length;
+}
+
+size_t MappedFileStream::length()
+{
+    return _length;
+}
+
+long int MappedFileStream::position()
+{
+    if (!_data)
+        return -1;
+    return (long int)_position;
+}
+
+bool MappedFileStream::seek(long int offset, int origin)
+{
+    if (!_data)
+        return false;
+
+    long int base = 0;
+    if (origin == SEEK_CUR)
+        base = (long int)_position;
+    else if (origin == SEEK_END)
+        base = (long int)_length;
+    else if (origin != SEEK_SET)
+        return false;
+
+    if (base + offset < 0)
+        return false;
+    _position = (size_t)(base + offset);
+    return true;
+}
+
+bool MappedFileStream::rewind()
+{
+    if (canSeek())
+    {
+        _position = 0;
+        return true;
+    }
+    return false;
+}
+
+#endif
+
+////////////////////////////////
+
 #ifdef __ANDROID__
 
 FileStreamAndroid::FileStreamAndroid(AAsset* asset)
@@ -24,7 +24,8 @@ public:
     enum StreamMode
     {
         READ = 1,
-        WRITE = 2
+        WRITE = 2,
+        MAPPED = 4  // With READ, maps the whole file into memory where the platform supports it.
     };
 
     /**
@@ -146,12 +147,24 @@ public:
      */
     static bool fileExists(const char* filePath);
 
+    /**
+     * Gets the last modification time of the file at the given path.
+     *
+     * @param filePath The path to the file.
+     *
+     * @return The modification time, or 0 if it is not known (such as for packaged assets).
+     */
+    static time_t getModifiedTime(const char* filePath);
+
     /**
      * Opens a byte stream for the given resource path.
      *
      * If <code>path</code> is a file path, the file at the specified location is opened relative to the currently set
      * resource path.
      *
+     * READ | MAPPED maps the file instead of buffering it, so Stream::readInPlace() can return
+     * pointers into it. Where a file can't be mapped it is opened as with READ alone.
+     *
      * @param path The path to the resource to be opened, relative to the currently set resource path.
      * @param streamMode The stream mode used to open the file.
      * 
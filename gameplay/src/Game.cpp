@@ -374,6 +374,10 @@ void Game::frame()
     // Fire time events to scheduled TimeListeners
     fireTimeEvents(frameTime);
 
+    // Create scenes read in the background and swap in textures decoded in the background.
+    Scene::finishAsyncLoads();
+    Texture::finishAsyncLoads();
+
     if (_state == Game::RUNNING)
     {
         GP_ASSERT(_animationController);
@@ -73,8 +73,15 @@ private:
 
 #define MATRIX_SIZE ( sizeof(float) * 16)
 
-#ifdef GP_USE_NEON
+// SSE2 is part of every x86-64 target, define GP_NO_SSE to build the scalar kernels instead.
+#if !defined(GP_USE_NEON) && !defined(GP_NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GP_USE_SSE
+#endif
+
+#if defined(GP_USE_NEON)
 #include "MathUtilNeon.inl"
+#elif defined(GP_USE_SSE)
+#include "MathUtilSSE.inl"
 #else
 #include "MathUtil.inl"
 #endif
@@ -0,0 +1,163 @@
+#include <emmintrin.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace gameplay
+{
+
+// Columns are multiplied and summed in the same order as MathUtil.inl, so the results match it bit for bit.
+
+inline void MathUtil::addMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    _mm_storeu_ps(&dst[0],  _mm_add_ps(_mm_loadu_ps(&m[0]),  s));
+    _mm_storeu_ps(&dst[4],  _mm_add_ps(_mm_loadu_ps(&m[4]),  s));
+    _mm_storeu_ps(&dst[8],  _mm_add_ps(_mm_loadu_ps(&m[8]),  s));
+    _mm_storeu_ps(&dst[12], _mm_add_ps(_mm_loadu_ps(&m[12]), s));
+}
+
+inline void MathUtil::addMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(&dst[0],  _mm_add_ps(_mm_loadu_ps(&m1[0]),  _mm_loadu_ps(&m2[0])));
+    _mm_storeu_ps(&dst[4],  _mm_add_ps(_mm_loadu_ps(&m1[4]),  _mm_loadu_ps(&m2[4])));
+    _mm_storeu_ps(&dst[8],  _mm_add_ps(_mm_loadu_ps(&m1[8]),  _mm_loadu_ps(&m2[8])));
+    _mm_storeu_ps(&dst[12], _mm_add_ps(_mm_loadu_ps(&m1[12]), _mm_loadu_ps(&m2[12])));
+}
+
+inline void MathUtil::subtractMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(&dst[0],  _mm_sub_ps(_mm_loadu_ps(&m1[0]),  _mm_loadu_ps(&m2[0])));
+    _mm_storeu_ps(&dst[4],  _mm_sub_ps(_mm_loadu_ps(&m1[4]),  _mm_loadu_ps(&m2[4])));
+    _mm_storeu_ps(&dst[8],  _mm_sub_ps(_mm_loadu_ps(&m1[8]),  _mm_loadu_ps(&m2[8])));
+    _mm_storeu_ps(&dst[12], _mm_sub_ps(_mm_loadu_ps(&m1[12]), _mm_loadu_ps(&m2[12])));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    _mm_storeu_ps(&dst[0],  _mm_mul_ps(_mm_loadu_ps(&m[0]),  s));
+    _mm_storeu_ps(&dst[4],  _mm_mul_ps(_mm_loadu_ps(&m[4]),  s));
+    _mm_storeu_ps(&dst[8],  _mm_mul_ps(_mm_loadu_ps(&m[8]),  s));
+    _mm_storeu_ps(&dst[12], _mm_mul_ps(_mm_loadu_ps(&m[12]), s));
+}
+
+#ifdef __AVX__
+
+inline void MathUtil::multiplyMatrix(const float* m1, const float* m2, float* dst)
+{
+    // Two columns of the product at a time. All of m1 and m2 are read before dst is written.
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)&m1[0]);
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)&m1[4]);
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)&m1[8]);
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)&m1[12]);
+
+    __m256 b01 = _mm256_loadu_ps(&m2[0]);
+    __m256 b23 = _mm256_loadu_ps(&m2[8]);
+
+    __m256 p01 = _mm256_mul_ps(c0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+    p01 = _mm256_add_ps(p01, _mm256_mul_ps(c1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1))));
+    p01 = _mm256_add_ps(p01, _mm256_mul_ps(c2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2))));
+    p01 = _mm256_add_ps(p01, _mm256_mul_ps(c3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3))));
+
+    __m256 p23 = _mm256_mul_ps(c0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+    p23 = _mm256_add_ps(p23, _mm256_mul_ps(c1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1))));
+    p23 = _mm256_add_ps(p23, _mm256_mul_ps(c2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2))));
+    p23 = _mm256_add_ps(p23, _mm256_mul_ps(c3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3))));
+
+    _mm256_storeu_ps(&dst[0], p01);
+    _mm256_storeu_ps(&dst[8], p23);
+}
+
+#else
+
+inline void MathUtil::multiplyMatrix(const float* m1, const float* m2, float* dst)
+{
+    // Support the case where m1 or m2 is the same array as dst.
+    __m128 c0 = _mm_loadu_ps(&m1[0]);
+    __m128 c1 = _mm_loadu_ps(&m1[4]);
+    __m128 c2 = _mm_loadu_ps(&m1[8]);
+    __m128 c3 = _mm_loadu_ps(&m1[12]);
+
+    __m128 product[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128 b = _mm_loadu_ps(&m2[i * 4]);
+        __m128 p = _mm_mul_ps(c0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+        p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+        p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+        p = _mm_add_ps(p, _mm_mul_ps(c3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+        product[i] = p;
+    }
+
+    _mm_storeu_ps(&dst[0],  product[0]);
+    _mm_storeu_ps(&dst[4],  product[1]);
+    _mm_storeu_ps(&dst[8],  product[2]);
+    _mm_storeu_ps(&dst[12], product[3]);
+}
+
+#endif
+
+inline void MathUtil::negateMatrix(const float* m, float* dst)
+{
+    // Flips the sign bit, as the scalar negation does.
+    __m128 sign = _mm_set1_ps(-0.0f);
+    _mm_storeu_ps(&dst[0],  _mm_xor_ps(_mm_loadu_ps(&m[0]),  sign));
+    _mm_storeu_ps(&dst[4],  _mm_xor_ps(_mm_loadu_ps(&m[4]),  sign));
+    _mm_storeu_ps(&dst[8],  _mm_xor_ps(_mm_loadu_ps(&m[8]),  sign));
+    _mm_storeu_ps(&dst[12], _mm_xor_ps(_mm_loadu_ps(&m[12]), sign));
+}
+
+inline void MathUtil::transposeMatrix(const float* m, float* dst)
+{
+    __m128 c0 = _mm_loadu_ps(&m[0]);
+    __m128 c1 = _mm_loadu_ps(&m[4]);
+    __m128 c2 = _mm_loadu_ps(&m[8]);
+    __m128 c3 = _mm_loadu_ps(&m[12]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(&dst[0],  c0);
+    _mm_storeu_ps(&dst[4],  c1);
+    _mm_storeu_ps(&dst[8],  c2);
+    _mm_storeu_ps(&dst[12], c3);
+}
+
+inline void MathUtil::transformVector4(const float* m, float x, float y, float z, float w, float* dst)
+{
+    // dst holds three floats.
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(&m[0]), _mm_set1_ps(x));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(&m[4]), _mm_set1_ps(y)));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(&m[8]), _mm_set1_ps(z)));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(&m[12]), _mm_set1_ps(w)));
+
+    _mm_storel_pi((__m64*)dst, p);
+    _mm_store_ss(&dst[2], _mm_movehl_ps(p, p));
+}
+
+inline void MathUtil::transformVector4(const float* m, const float* v, float* dst)
+{
+    // The shuffles cost more than they save, MathBench has the scalar code ahead.
+    // Handle case where v == dst.
+    float x = v[0] * m[0] + v[1] * m[4] + v[2] * m[8] + v[3] * m[12];
+    float y = v[0] * m[1] + v[1] * m[5] + v[2] * m[9] + v[3] * m[13];
+    float z = v[0] * m[2] + v[1] * m[6] + v[2] * m[10] + v[3] * m[14];
+    float w = v[0] * m[3] + v[1] * m[7] + v[2] * m[11] + v[3] * m[15];
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+    dst[3] = w;
+}
+
+inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
+{
+    // Three wide, the scalar code is as fast.
+    float x = (v1[1] * v2[2]) - (v1[2] * v2[1]);
+    float y = (v1[2] * v2[0]) - (v1[0] * v2[2]);
+    float z = (v1[0] * v2[1]) - (v1[1] * v2[0]);
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+}
@@ -72,7 +72,15 @@ void Node::setId(const char* id)
 {
     if (id)
     {
+        // Keep the scene's ID index in step.
+        Scene* scene = getScene();
+        if (scene)
+            scene->unindexNode(this, false);
+
         _id = id;
+
+        if (scene)
+            scene->indexNode(this, false);
     }
 }
 
@@ -122,6 +130,13 @@ void Node::addChild(Node* child)
     ++_childCount;
     setBoundsDirty();
 
+    Scene* scene = getScene();
+    if (scene)
+    {
+        scene->indexNode(child, true);
+        scene->_transformOrderDirty = true;
+    }
+
     if (_dirtyBits & NODE_DIRTY_HIERARCHY)
     {
         hierarchyChanged();
@@ -135,6 +150,13 @@ void Node::removeChild(Node* child)
         // The child is not in our hierarchy.
         return;
     }
+    Scene* scene = getScene();
+    if (scene)
+    {
+        scene->unindexNode(child, true);
+        scene->_transformOrderDirty = true;
+    }
+
     // Call remove on the child.
     child->remove();
     SAFE_RELEASE(child);
@@ -466,6 +488,27 @@ const Matrix& Node::getWorldMatrix() const
     return _world;
 }
 
+void Node::updateWorldMatrix() const
+{
+    if (!(_dirtyBits & NODE_DIRTY_WORLD))
+        return;
+    _dirtyBits &= ~NODE_DIRTY_WORLD;
+
+    // Same as getWorldMatrix, but the parent is already up to date and children come later in the sweep.
+    if (!isStatic())
+    {
+        Node* parent = getParent();
+        if (parent && (!_collisionObject || _collisionObject->isKinematic()))
+        {
+            Matrix::multiply(parent->_world, getMatrix(), &_world);
+        }
+        else
+        {
+            _world = getMatrix();
+        }
+    }
+}
+
 const Matrix& Node::getWorldViewMatrix() const
 {
     static Matrix worldView;
@@ -827,6 +870,14 @@ void Node::setDrawable(Drawable* drawable)
                 ref->addRef();
             _drawable->setNode(this);
         }
+
+        // Re-index so the scene knows whether this node holds a skin.
+        Scene* scene = getScene();
+        if (scene)
+        {
+            scene->unindexNode(this, false);
+            scene->indexNode(this, false);
+        }
     }
     setBoundsDirty();
 }
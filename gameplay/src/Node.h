@@ -599,6 +599,13 @@ public:
      */
     const BoundingSphere& getBoundingSphere() const;
 
+    /**
+     * Marks the bounding volume of the node as dirty.
+     *
+     * Call this after changing the bounds of the node's mesh.
+     */
+    void setBoundsDirty();
+
     /**
      * Clones the node and all of its child nodes.
      *
@@ -660,11 +667,6 @@ protected:
      */
     void hierarchyChanged();
 
-    /**
-     * Marks the bounding volume of the node as dirty.
-     */
-    void setBoundsDirty();
-
     /**
      * Returns the first child node that matches the given ID.
      *
@@ -712,6 +714,13 @@ private:
 
     PhysicsCollisionObject* setCollisionObject(Properties* properties);
 
+    /**
+     * Recomputes a dirty world matrix from the parent's, without visiting children.
+     *
+     * Used by Scene::updateTransforms, which reaches parents before their children.
+     */
+    void updateWorldMatrix() const;
+
 protected:
 
     /** The scene this node is attached to. */
@@ -61,7 +61,7 @@ static bool endsWith(const char* str, const char* suffix, bool ignoreCase)
 
 Scene::Scene()
     : _id(""), _activeCamera(NULL), _firstNode(NULL), _lastNode(NULL), _nodeCount(0), _bindAudioListenerToCamera(true), 
-      _nextItr(NULL), _nextReset(true)
+      _nextItr(NULL), _nextReset(true), _transformOrderDirty(true)
 {
     __sceneList.push_back(this);
 }
@@ -112,6 +112,22 @@ Scene* Scene::load(const char* filePath)
     return SceneLoader::load(filePath);
 }
 
+void Scene::loadAsync(const char* filePath, const LoadCallback& callback)
+{
+    GP_ASSERT(filePath);
+    SceneLoader::loadAsync(filePath, endsWith(filePath, ".gpb", true), callback);
+}
+
+void Scene::finishAsyncLoads()
+{
+    SceneLoader::finishAsyncLoads();
+}
+
+Scene::LoadProgress::LoadProgress()
+    : phase(LOAD_READ), progress(0.0f), readTime(0.0), decodeTime(0.0), createTime(0.0), textureCount(0)
+{
+}
+
 Scene* Scene::getScene(const char* id)
 {
     if (id == NULL)
@@ -141,6 +157,17 @@ Node* Scene::findNode(const char* id, bool recursive, bool exactMatch) const
 {
     GP_ASSERT(id);
 
+    // A single indexed node is the match. Duplicate IDs walk the hierarchy to keep its
+    // search order, and so do misses when joints of mesh skins may hold the ID.
+    if (recursive && exactMatch)
+    {
+        size_t count = _nodeIndex.count(id);
+        if (count == 1)
+            return _nodeIndex.find(id)->second;
+        if (count == 0 && _skinnedNodes.empty())
+            return NULL;
+    }
+
     // Search immediate children first.
     for (Node* child = getFirstNode(); child != NULL; child = child->getNextSibling())
     {
@@ -273,6 +300,9 @@ void Scene::addNode(Node* node)
 
     ++_nodeCount;
 
+    indexNode(node, true);
+    _transformOrderDirty = true;
+
     // If we don't have an active camera set, then check for one and set it.
     if (_activeCamera == NULL)
     {
@@ -291,6 +321,9 @@ void Scene::removeNode(Node* node)
     if (node->_scene != this)
         return;
 
+    unindexNode(node, true);
+    _transformOrderDirty = true;
+
     if (node == _firstNode)
     {
         _firstNode = node->_nextSibling;
@@ -316,6 +349,45 @@ void Scene::removeAllNodes()
     }
 }
 
+void Scene::indexNode(Node* node, bool recursive)
+{
+    GP_ASSERT(node);
+
+    _nodeIndex.emplace(node->_id, node);
+
+    Model* model = dynamic_cast<Model*>(node->getDrawable());
+    if (model && model->getSkin())
+        _skinnedNodes.insert(node);
+
+    if (recursive)
+    {
+        for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+            indexNode(child, true);
+    }
+}
+
+void Scene::unindexNode(Node* node, bool recursive)
+{
+    GP_ASSERT(node);
+
+    auto range = _nodeIndex.equal_range(node->_id);
+    for (auto itr = range.first; itr != range.second; ++itr)
+    {
+        if (itr->second == node)
+        {
+            _nodeIndex.erase(itr);
+            break;
+        }
+    }
+    _skinnedNodes.erase(node);
+
+    if (recursive)
+    {
+        for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+            unindexNode(child, true);
+    }
+}
+
 unsigned int Scene::getNodeCount() const
 {
     return _nodeCount;
@@ -395,6 +467,72 @@ void Scene::update(float elapsedTime)
     }
 }
 
+// Below this many nodes per thread the threads cost more than they save.
+static const size_t MIN_TRANSFORMS_PER_THREAD = 4096;
+
+void Scene::updateTransforms(unsigned int threadCount)
+{
+    if (_transformOrderDirty)
+        buildTransformOrder();
+
+    size_t count = _transformOrder.size();
+    threadCount = (unsigned int)std::min<size_t>(threadCount, count / MIN_TRANSFORMS_PER_THREAD);
+    if (threadCount <= 1 || _transformRoots.size() < 2)
+    {
+        updateTransformRange(0, count);
+        return;
+    }
+
+    // Top level subtrees are contiguous and independent, so each thread takes a run of whole subtrees.
+    std::vector<std::thread> threads;
+    size_t perThread = count / threadCount;
+    size_t begin = 0;
+    for (size_t i = 1; i < _transformRoots.size() && threads.size() + 1 < threadCount; ++i)
+    {
+        size_t end = _transformRoots[i];
+        if (end - begin >= perThread)
+        {
+            threads.push_back(std::thread(&Scene::updateTransformRange, this, begin, end));
+            begin = end;
+        }
+    }
+    updateTransformRange(begin, count);
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
+
+void Scene::buildTransformOrder()
+{
+    _transformOrder.clear();
+    _transformRoots.clear();
+
+    // Depth first, so each subtree is one contiguous run after its root.
+    std::vector<Node*> stack;
+    for (Node* root = _firstNode; root != NULL; root = root->_nextSibling)
+    {
+        _transformRoots.push_back(_transformOrder.size());
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            Node* node = stack.back();
+            stack.pop_back();
+            _transformOrder.push_back(node);
+
+            for (Node* child = node->_firstChild; child != NULL; child = child->_nextSibling)
+                stack.push_back(child);
+        }
+    }
+
+    _transformOrderDirty = false;
+}
+
+void Scene::updateTransformRange(size_t begin, size_t end) const
+{
+    for (size_t i = begin; i < end; ++i)
+        _transformOrder[i]->updateWorldMatrix();
+}
+
 void Scene::reset()
 {
     _nextItr = NULL;
@@ -17,6 +17,8 @@ namespace gameplay
  */
 class Scene : public Ref
 {
+    friend class Node;
+
 public:
 
     /**
@@ -39,6 +41,66 @@ public:
      */
     static Scene* load(const char* filePath);
 
+    /**
+     * Phases of an asynchronous scene load, in order.
+     *
+     * @script{ignore}
+     */
+    enum LoadPhase
+    {
+        LOAD_READ,   // Reading the scene, material and bundle files on a worker thread.
+        LOAD_DECODE, // Reading mesh data and collecting texture paths on a worker thread.
+        LOAD_CREATE, // Creating the nodes, meshes and materials on the main thread.
+        LOAD_DONE
+    };
+
+    /**
+     * Progress of an asynchronous scene load. Times are in milliseconds.
+     *
+     * @script{ignore}
+     */
+    struct LoadProgress
+    {
+        LoadProgress();
+
+        LoadPhase phase;
+        float progress;           // From 0 to 1 over the whole load.
+        double readTime;
+        double decodeTime;
+        double createTime;
+        unsigned int textureCount; // Textures still decoding in the background once the scene is created.
+    };
+
+    /**
+     * Called on the main thread as an asynchronous load progresses. The scene is NULL until
+     * the phase is LOAD_DONE, then it is the loaded scene or NULL if loading failed.
+     * The callback owns the reference to the scene, as the caller of load() does.
+     *
+     * @script{ignore}
+     */
+    typedef std::function<void(Scene* scene, const LoadProgress& progress)> LoadCallback;
+
+    /**
+     * Loads a scene from the given '.scene' or '.gpb' file without blocking the main thread.
+     *
+     * The scene file, the material files and the main bundle's mesh data are read on a worker
+     * thread. The scene is then created on the main thread from finishAsyncLoads(), since that
+     * creates GL objects. PNG textures are decoded in the background, see Texture::create,
+     * and show a placeholder until they are uploaded.
+     *
+     * @param filePath The path to the '.scene' or '.gpb' file to load from.
+     * @param callback Called with the progress of the load and then the scene.
+     * @script{ignore}
+     */
+    static void loadAsync(const char* filePath, const LoadCallback& callback);
+
+    /**
+     * Reports progress and creates the scenes read by loadAsync(). Game calls this every frame.
+     *
+     * @script{ignore}
+     */
+    static void finishAsyncLoads();
+
     /**
      * Gets a currently active scene.
      *
@@ -67,6 +129,9 @@ public:
     /**
      * Returns the first node in the scene that matches the given ID.
      *
+     * Recursive exact matches are looked up in a hash index of the node IDs in the scene,
+     * other searches walk the hierarchy.
+     *
      * @param id The ID of the node to find.
      * @param recursive true if a recursive search should be performed, false otherwise.
      * @param exactMatch true if only nodes whose ID exactly matches the specified ID are returned,
@@ -188,6 +253,17 @@ public:
      */
     void update(float elapsedTime);
 
+    /**
+     * Brings the world matrix of every node in the scene up to date.
+     *
+     * Nodes are kept in a flat parent before child order, so dirty world matrices are
+     * recomputed in one pass instead of recursively on the first getWorldMatrix call.
+     * Worth calling once per frame after transforms are set, for scenes with many nodes.
+     *
+     * @param threadCount Threads to split the top level subtrees over. Small scenes always use one.
+     */
+    void updateTransforms(unsigned int threadCount = 1);
+
     /**
      * Visits each node in the scene and calls the specified method pointer.
      *
@@ -299,6 +375,26 @@ private:
 
     bool isNodeVisible(Node* node);
 
+    /**
+     * Adds the node, and its children if recursive, to the ID index.
+     */
+    void indexNode(Node* node, bool recursive);
+
+    /**
+     * Removes the node, and its children if recursive, from the ID index.
+     */
+    void unindexNode(Node* node, bool recursive);
+
+    /**
+     * Flattens the hierarchy for updateTransforms.
+     */
+    void buildTransformOrder();
+
+    /**
+     * Updates the world matrices of the flattened nodes in [begin, end).
+     */
+    void updateTransformRange(size_t begin, size_t end) const;
+
     std::string _id;
     Camera* _activeCamera;
     Node* _firstNode;
@@ -308,6 +404,11 @@ private:
     bool _bindAudioListenerToCamera;
     Node* _nextItr;
     bool _nextReset;
+    std::unordered_multimap<std::string, Node*> _nodeIndex;
+    std::set<Node*> _skinnedNodes;
+    std::vector<Node*> _transformOrder;
+    std::vector<size_t> _transformRoots;
+    bool _transformOrderDirty;
 };
 
 template <class T>
@@ -9,6 +9,8 @@
 #include "Text.h"
 #include "TileSet.h"
 #include "Light.h"
+#include <condition_variable>
+#include <deque>
 
 namespace gameplay
 {
@@ -17,7 +19,7 @@ namespace gameplay
 extern void calculateNamespacePath(const std::string& urlString, std::string& fileString, std::vector<std::string>& namespacePath);
 extern Properties* getPropertiesFromNamespacePath(Properties* properties, const std::vector<std::string>& namespacePath);
 
-SceneLoader::SceneLoader() : _scene(NULL)
+SceneLoader::SceneLoader() : _sceneFile(NULL), _sceneProperties(NULL), _scene(NULL)
 {
 }
 
@@ -27,7 +29,294 @@ Scene* SceneLoader::load(const char* url)
     return loader.loadInternal(url);
 }
 
+// A scene being loaded by loadAsync. The loader thread owns it until it is read, then the main thread does.
+struct SceneLoader::AsyncLoad
+{
+    AsyncLoad() : loader(NULL), bundle(NULL), progressChanged(false), read(false) {}
+
+    std::string path;
+    Scene::LoadCallback callback;
+    SceneLoader* loader;                  // Reads and creates a .scene file, NULL for a .gpb file.
+    Bundle* bundle;                       // The main bundle, opened and preloaded off the cache.
+    std::map<std::string, bool> textures; // Sampler paths in the materials, and whether they are mipmapped.
+    Scene::LoadProgress progress;         // The rest is guarded by the queue's mutex.
+    bool progressChanged;
+    bool read;
+};
+
+// Reads queued loads one at a time on a loader thread.
+class SceneLoader::AsyncLoadQueue
+{
+public:
+
+    ~AsyncLoadQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _queued.notify_all();
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    void push(AsyncLoad* load)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_thread.joinable())
+            _thread = std::thread(&AsyncLoadQueue::run, this);
+        _loads.push_back(load);
+        _pending.push_back(load);
+        _queued.notify_one();
+    }
+
+    void report(AsyncLoad* load, const Scene::LoadProgress& progress, bool read = false)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        load->progress = progress;
+        load->progressChanged = true;
+        load->read = read;
+    }
+
+    // Copies out progress reported since the last poll and takes the loads that have been read.
+    void poll(std::vector<std::pair<AsyncLoad*, Scene::LoadProgress> >& changed, std::vector<AsyncLoad*>& read)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = 0; i < _loads.size(); )
+        {
+            AsyncLoad* load = _loads[i];
+            if (load->progressChanged)
+            {
+                changed.push_back(std::make_pair(load, load->progress));
+                load->progressChanged = false;
+            }
+
+            if (load->read)
+            {
+                read.push_back(load);
+                _loads.erase(_loads.begin() + i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+private:
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            _queued.wait(lock, [this]() { return _stop || !_pending.empty(); });
+            if (_stop)
+                return;
+
+            AsyncLoad* load = _pending.front();
+            _pending.pop_front();
+
+            lock.unlock();
+            readAsync(load, *this);
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _queued;
+    std::vector<AsyncLoad*> _loads;
+    std::deque<AsyncLoad*> _pending;
+    std::thread _thread;
+    bool _stop = false;
+};
+
+// Milliseconds since start.
+static double elapsedTime(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Texture paths of every sampler in the properties, so their decoding can start before the materials are made.
+static void collectTextures(Properties* properties, std::map<std::string, bool>& textures)
+{
+    GP_ASSERT(properties);
+
+    if (strcmp(properties->getNamespace(), "sampler") == 0)
+    {
+        std::string path;
+        if (properties->getPath("path", &path))
+        {
+            bool& mipmap = textures[path];
+            mipmap = mipmap || properties->getBool("mipmap");
+        }
+    }
+
+    properties->rewind();
+    Properties* ns;
+    while ((ns = properties->getNextNamespace()))
+    {
+        collectTextures(ns, textures);
+    }
+    properties->rewind();
+}
+
+void SceneLoader::loadAsync(const char* url, bool bundle, const Scene::LoadCallback& callback)
+{
+    GP_ASSERT(url);
+
+    AsyncLoad* load = new AsyncLoad();
+    load->path = url;
+    load->callback = callback;
+    if (!bundle)
+        load->loader = new SceneLoader();
+
+    getAsyncLoadQueue().push(load);
+}
+
+void SceneLoader::finishAsyncLoads()
+{
+    std::vector<std::pair<AsyncLoad*, Scene::LoadProgress> > changed;
+    std::vector<AsyncLoad*> read;
+    getAsyncLoadQueue().poll(changed, read);
+
+    for (size_t i = 0, count = changed.size(); i < count; ++i)
+    {
+        if (changed[i].first->callback)
+            changed[i].first->callback(NULL, changed[i].second);
+    }
+
+    for (size_t i = 0, count = read.size(); i < count; ++i)
+    {
+        AsyncLoad* load = read[i];
+        Scene::LoadProgress progress = load->progress;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Scene* scene = createAsync(load, progress);
+        progress.createTime = elapsedTime(start);
+        progress.phase = Scene::LOAD_DONE;
+        progress.progress = 1.0f;
+
+        Logger::log(Logger::LEVEL_INFO, "Loaded scene '%s' in %.1f ms reading, %.1f ms decoding and %.1f ms creating, %u textures still decoding.\n",
+            load->path.c_str(), progress.readTime, progress.decodeTime, progress.createTime, progress.textureCount);
+
+        if (load->callback)
+            load->callback(scene, progress);
+        else
+            SAFE_RELEASE(scene);
+        SAFE_DELETE(load);
+    }
+}
+
+SceneLoader::AsyncLoadQueue& SceneLoader::getAsyncLoadQueue()
+{
+    static AsyncLoadQueue queue;
+    return queue;
+}
+
+void SceneLoader::readAsync(AsyncLoad* load, AsyncLoadQueue& queue)
+{
+    GP_ASSERT(load);
+
+    // The scene file and the files it references, then the main bundle's reference table.
+    Scene::LoadProgress progress;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::string gpbPath = load->path;
+    if (load->loader)
+    {
+        if (load->loader->readSceneFile(load->path.c_str()))
+        {
+            gpbPath = load->loader->_gpbPath;
+        }
+        else
+        {
+            SAFE_DELETE(load->loader);
+            gpbPath.clear();
+        }
+    }
+    if (!gpbPath.empty())
+    {
+        // Opened off the cache, so nothing on the main thread can use it until it is read.
+        load->bundle = Bundle::open(gpbPath.c_str());
+    }
+
+    progress.readTime = elapsedTime(start);
+    progress.phase = Scene::LOAD_DECODE;
+    progress.progress = 0.1f;
+    queue.report(load, progress);
+
+    // Mesh data and the bundle's material file, then the textures all the materials use.
+    start = std::chrono::steady_clock::now();
+    if (load->bundle)
+    {
+        load->bundle->preload([&](unsigned int meshesRead, unsigned int meshCount)
+        {
+            progress.progress = 0.1f + 0.8f * (float)meshesRead / (float)meshCount;
+            progress.decodeTime = elapsedTime(start);
+            queue.report(load, progress);
+        });
+
+        if (load->bundle->_materialProperties)
+            collectTextures(load->bundle->_materialProperties, load->textures);
+    }
+    if (load->loader)
+    {
+        collectTextures(load->loader->_sceneFile, load->textures);
+        for (std::map<std::string, Properties*>::iterator itr = load->loader->_propertiesFromFile.begin(); itr != load->loader->_propertiesFromFile.end(); ++itr)
+        {
+            if (itr->second)
+                collectTextures(itr->second, load->textures);
+        }
+    }
+
+    progress.decodeTime = elapsedTime(start);
+    progress.phase = Scene::LOAD_CREATE;
+    progress.progress = 0.9f;
+    queue.report(load, progress, true);
+}
+
+Scene* SceneLoader::createAsync(AsyncLoad* load, Scene::LoadProgress& progress)
+{
+    GP_ASSERT(load);
+
+    // Cached, the loads below find the bundle and its preloaded data.
+    if (load->bundle)
+        load->bundle = Bundle::addToCache(load->bundle);
+
+    // The materials then find these in the texture cache while they decode.
+    std::vector<Texture*> textures;
+    for (std::map<std::string, bool>::iterator itr = load->textures.begin(); itr != load->textures.end(); ++itr)
+    {
+        Texture* texture = Texture::create(itr->first.c_str(), itr->second, true);
+        if (texture)
+            textures.push_back(texture);
+    }
+    progress.textureCount = (unsigned int)textures.size();
+
+    Scene* scene = NULL;
+    if (load->loader)
+        scene = load->loader->createScene();
+    else if (load->bundle)
+        scene = load->bundle->loadScene();
+
+    for (size_t i = 0, count = textures.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(textures[i]);
+    }
+    if (load->bundle)
+        load->bundle->clearPreload();
+    SAFE_RELEASE(load->bundle);
+    SAFE_DELETE(load->loader);
+    return scene;
+}
+
 Scene* SceneLoader::loadInternal(const char* url)
+{
+    return readSceneFile(url) ? createScene() : NULL;
+}
+
+bool SceneLoader::readSceneFile(const char* url)
 {
     // Get the file part of the url that we are loading the scene from.
     std::string urlStr = url ? url : "";
@@ -39,7 +328,7 @@ Scene* SceneLoader::loadInternal(const char* url)
     if (properties == NULL)
     {
         GP_ERROR("Failed to load scene file '%s'.", url);
-        return NULL;
+        return false;
     }
 
     // Check if the properties object is valid and has a valid namespace.
@@ -48,7 +337,7 @@ Scene* SceneLoader::loadInternal(const char* url)
     {
         GP_ERROR("Failed to load scene from properties object: must be non-null object and have namespace equal to 'scene'.");
         SAFE_DELETE(properties);
-        return NULL;
+        return false;
     }
 
     // Get the path to the main GPB.
@@ -62,6 +351,19 @@ Scene* SceneLoader::loadInternal(const char* url)
     buildReferenceTables(sceneProperties);
     loadReferencedFiles();
 
+    _sceneFile = properties;
+    _sceneProperties = sceneProperties;
+    return true;
+}
+
+Scene* SceneLoader::createScene()
+{
+    GP_ASSERT(_sceneFile && _sceneProperties);
+    Properties* properties = _sceneFile;
+    Properties* sceneProperties = _sceneProperties;
+    _sceneFile = NULL;
+    _sceneProperties = NULL;
+
     // Load the main scene data from GPB and apply the global scene properties.
     if (!_gpbPath.empty())
     {
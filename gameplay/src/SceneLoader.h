@@ -29,6 +29,32 @@ private:
      * @param url The URL pointing to the Properties object defining the scene.
      */
     static Scene* load(const char* url);
+
+    /**
+     * Starts loading a scene in the background, see Scene::loadAsync.
+     *
+     * @param url The URL of the scene file, or the path of a bundle file.
+     * @param bundle True when url is a bundle file rather than a scene file.
+     * @param callback Called with the progress of the load and then the scene.
+     */
+    static void loadAsync(const char* url, bool bundle, const Scene::LoadCallback& callback);
+
+    /**
+     * Reports progress and creates the scenes whose files have been read, see Scene::finishAsyncLoads.
+     */
+    static void finishAsyncLoads();
+
+    /**
+     * Helper structures and functions for SceneLoader::loadAsync(const char*, bool, const Scene::LoadCallback&).
+     */
+    struct AsyncLoad;
+    class AsyncLoadQueue;
+
+    static AsyncLoadQueue& getAsyncLoadQueue();
+
+    static void readAsync(AsyncLoad* load, AsyncLoadQueue& queue);
+
+    static Scene* createAsync(AsyncLoad* load, Scene::LoadProgress& progress);
     
     /**
      * Helper structures and functions for SceneLoader::load(const char*).
@@ -90,6 +116,17 @@ private:
 
     Scene* loadInternal(const char* url);
 
+    /**
+     * Parses the scene file and the properties files it references. Creates no GL objects,
+     * so asynchronous loads run it on a worker thread.
+     */
+    bool readSceneFile(const char* url);
+
+    /**
+     * Creates the scene read by readSceneFile(), on the main thread.
+     */
+    Scene* createScene();
+
     void applyTags(SceneNode& sceneNode);
 
     void addSceneAnimation(const char* animationID, const char* targetID, const char* url);
@@ -134,6 +171,8 @@ private:
     std::vector<SceneNode> _sceneNodes;                     // Holds all the nodes+properties declared in the .scene file.
     std::string _gpbPath;                                   // The path of the main GPB for the scene being loaded.
     std::string _path;                                      // The path of the scene file being loaded.
+    Properties* _sceneFile;                                 // The .scene file's properties, between readSceneFile and createScene.
+    Properties* _sceneProperties;                           // The scene namespace of _sceneFile.
     Scene* _scene;                                          // The scene being loaded
 };
 
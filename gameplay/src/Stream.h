@@ -66,6 +66,21 @@ public:
      */
     virtual size_t read(void* ptr, size_t size, size_t count) = 0;
 
+    /**
+     * Reads <code>size</code> bytes without copying them, for streams that hold all of their
+     * content in memory such as mapped files.
+     * 
+     * The returned bytes stay valid until the stream is closed and may not be aligned.
+     * Streams that can only copy return NULL and don't move, use read() with those.
+     * 
+     * @param size The number of bytes to read.
+     * 
+     * @return A pointer to the bytes, or NULL if the stream can't read in place or fewer bytes remain.
+     * 
+     * @see canRead()
+     */
+    virtual const void* readInPlace(size_t /*size*/) { return NULL; }
+
     /**
      * Reads a line from the stream.
      * 
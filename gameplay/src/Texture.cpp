@@ -2,6 +2,8 @@
 #include "Image.h"
 #include "Texture.h"
 #include "FileSystem.h"
+#include <condition_variable>
+#include <deque>
 
 // PVRTC (GL_IMG_texture_compression_pvrtc) : Imagination based gpus
 #ifndef GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG
@@ -47,11 +49,87 @@
 namespace gameplay
 {
 
-static std::vector<Texture*> __textureCache;
+static std::unordered_map<std::string, Texture*> __textureCache;
 static TextureHandle __currentTextureId = 0;
 static Texture::Type __currentTextureType = Texture::TEXTURE_2D;
 
-Texture::Texture() : _handle(0), _format(UNKNOWN), _type((Texture::Type)0), _width(0), _height(0), _mipmapped(false), _cached(false), _compressed(false),
+// A PNG being decoded in the background for a texture that shows a placeholder meanwhile.
+struct TextureLoad
+{
+    Texture* texture;
+    std::string path;
+    bool generateMipmaps;
+    Image* image;
+};
+
+// Decodes queued loads on a few worker threads and hands the images back to the render thread.
+class TextureLoader
+{
+public:
+
+    ~TextureLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _queued.notify_all();
+        for (size_t i = 0; i < _threads.size(); ++i)
+            _threads[i].join();
+    }
+
+    void push(const TextureLoad& load)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_threads.empty())
+        {
+            unsigned int count = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+            for (unsigned int i = 0; i < count; ++i)
+                _threads.push_back(std::thread(&TextureLoader::run, this));
+        }
+        _pending.push_back(load);
+        _queued.notify_one();
+    }
+
+    void takeFinished(std::vector<TextureLoad>& loads)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        loads.swap(_finished);
+    }
+
+private:
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            _queued.wait(lock, [this]() { return _stop || !_pending.empty(); });
+            if (_stop)
+                return;
+
+            TextureLoad load = _pending.front();
+            _pending.pop_front();
+
+            lock.unlock();
+            load.image = Image::create(load.path.c_str());
+            lock.lock();
+
+            _finished.push_back(load);
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _queued;
+    std::deque<TextureLoad> _pending;
+    std::vector<TextureLoad> _finished;
+    std::vector<std::thread> _threads;
+    bool _stop = false;
+};
+
+static TextureLoader __textureLoader;
+
+Texture::Texture() : _modifiedTime(0), _handle(0), _format(UNKNOWN), _type((Texture::Type)0), _width(0), _height(0), _mipmapped(false), _cached(false), _compressed(false),
     _wrapS(Texture::REPEAT), _wrapT(Texture::REPEAT), _wrapR(Texture::REPEAT), _minFilter(Texture::NEAREST_MIPMAP_LINEAR), _magFilter(Texture::LINEAR)
 {
 }
@@ -67,24 +145,28 @@ Texture::~Texture()
     // Remove ourself from the texture cache.
     if (_cached)
     {
-        std::vector<Texture*>::iterator itr = std::find(__textureCache.begin(), __textureCache.end(), this);
-        if (itr != __textureCache.end())
+        std::unordered_map<std::string, Texture*>::iterator itr = __textureCache.find(_cacheKey);
+        if (itr != __textureCache.end() && itr->second == this)
         {
             __textureCache.erase(itr);
         }
     }
 }
 
-Texture* Texture::create(const char* path, bool generateMipmaps)
+Texture* Texture::create(const char* path, bool generateMipmaps, bool async)
 {
     GP_ASSERT( path );
 
+    std::string cacheKey = FileSystem::resolvePath(path);
+    time_t modifiedTime = FileSystem::getModifiedTime(cacheKey.c_str());
+
     // Search texture cache first.
-    for (size_t i = 0, count = __textureCache.size(); i < count; ++i)
+    std::unordered_map<std::string, Texture*>::iterator itr = __textureCache.find(cacheKey);
+    if (itr != __textureCache.end())
     {
-        Texture* t = __textureCache[i];
+        Texture* t = itr->second;
         GP_ASSERT( t );
-        if (t->_path == path)
+        if (t->_modifiedTime == modifiedTime)
         {
             // If 'generateMipmaps' is true, call Texture::generateMipamps() to force the
             // texture to generate its mipmap chain if it hasn't already done so.
@@ -98,12 +180,16 @@ Texture* Texture::create(const char* path, bool generateMipmaps)
 
             return t;
         }
+
+        // The file changed since it was loaded, users of the old texture keep it.
+        t->_cached = false;
+        __textureCache.erase(itr);
     }
 
     Texture* texture = NULL;
 
     // Filter loading based on file extension.
-    const char* ext = strrchr(FileSystem::resolvePath(path), '.');
+    const char* ext = strrchr(cacheKey.c_str(), '.');
     if (ext)
     {
         switch (strlen(ext))
@@ -111,10 +197,17 @@ Texture* Texture::create(const char* path, bool generateMipmaps)
         case 4:
             if (tolower(ext[1]) == 'p' && tolower(ext[2]) == 'n' && tolower(ext[3]) == 'g')
             {
-                Image* image = Image::create(path);
-                if (image)
-                    texture = create(image, generateMipmaps);
-                SAFE_RELEASE(image);
+                if (async)
+                {
+                    texture = createAsync(cacheKey.c_str(), generateMipmaps);
+                }
+                else
+                {
+                    Image* image = Image::create(path);
+                    if (image)
+                        texture = create(image, generateMipmaps);
+                    SAFE_RELEASE(image);
+                }
             }
             else if (tolower(ext[1]) == 'p' && tolower(ext[2]) == 'v' && tolower(ext[3]) == 'r')
             {
@@ -133,10 +226,12 @@ Texture* Texture::create(const char* path, bool generateMipmaps)
     if (texture)
     {
         texture->_path = path;
+        texture->_cacheKey = cacheKey;
+        texture->_modifiedTime = modifiedTime;
         texture->_cached = true;
 
         // Add to texture cache.
-        __textureCache.push_back(texture);
+        __textureCache[cacheKey] = texture;
 
         return texture;
     }
@@ -145,6 +240,78 @@ Texture* Texture::create(const char* path, bool generateMipmaps)
     return NULL;
 }
 
+Texture* Texture::createAsync(const char* path, bool generateMipmaps)
+{
+    // A flat normal, so normal maps light correctly while they load.
+    static const unsigned char placeholder[] = { 128, 128, 255, 255 };
+
+    Texture* texture = create(Texture::RGBA, 1, 1, placeholder, generateMipmaps);
+    if (texture)
+    {
+        // The load keeps the texture alive until it is uploaded.
+        texture->addRef();
+
+        TextureLoad load = { texture, path, generateMipmaps, NULL };
+        __textureLoader.push(load);
+    }
+    return texture;
+}
+
+void Texture::finishAsyncLoads()
+{
+    std::vector<TextureLoad> loads;
+    __textureLoader.takeFinished(loads);
+
+    for (size_t i = 0, count = loads.size(); i < count; ++i)
+    {
+        Texture* texture = loads[i].texture;
+        Image* image = loads[i].image;
+
+        if (!image)
+        {
+            // Keep the placeholder, but let the next request try again.
+            GP_WARN("Failed to load texture from file '%s'.", loads[i].path.c_str());
+            if (texture->_cached)
+            {
+                std::unordered_map<std::string, Texture*>::iterator itr = __textureCache.find(texture->_cacheKey);
+                if (itr != __textureCache.end() && itr->second == texture)
+                    __textureCache.erase(itr);
+                texture->_cached = false;
+            }
+        }
+        else if (texture->getRefCount() > 1)
+        {
+            // Only the load still holds textures that were released meanwhile, skip their upload.
+            Format format = (image->getFormat() == Image::RGBA) ? Texture::RGBA : Texture::RGB;
+            GLint internalFormat = getFormatInternal(format);
+            GLenum texelType = getFormatTexel(format);
+
+            GL_ASSERT( glBindTexture(GL_TEXTURE_2D, texture->_handle) );
+            GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+            GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image->getWidth(), image->getHeight(), 0, internalFormat, texelType, image->getData()) );
+
+            texture->_format = format;
+            texture->_width = image->getWidth();
+            texture->_height = image->getHeight();
+            texture->_internalFormat = internalFormat;
+            texture->_texelType = texelType;
+            texture->_bpp = getFormatBPP(format);
+
+            // Mipmaps may also have been asked for by a cache hit while loading.
+            bool mipmaps = loads[i].generateMipmaps || texture->_mipmapped;
+            texture->_mipmapped = false;
+            if (mipmaps)
+                texture->generateMipmaps();
+
+            // Restore the texture id
+            GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
+        }
+
+        SAFE_RELEASE(image);
+        SAFE_RELEASE(texture);
+    }
+}
+
 Texture* Texture::create(Image* image, bool generateMipmaps)
 {
     GP_ASSERT( image );
@@ -1230,9 +1397,9 @@ Texture::Sampler* Texture::Sampler::create(Texture* texture)
     return new Sampler(texture);
 }
 
-Texture::Sampler* Texture::Sampler::create(const char* path, bool generateMipmaps)
+Texture::Sampler* Texture::Sampler::create(const char* path, bool generateMipmaps, bool async)
 {
-    Texture* texture = Texture::create(path, generateMipmaps);
+    Texture* texture = Texture::create(path, generateMipmaps, async);
     return texture ? new Sampler(texture) : NULL;
 }
 
@@ -113,11 +113,12 @@ public:
          *
          * @param path Path to the texture to create a sampler for.
          * @param generateMipmaps True to force a full mipmap chain to be generated for the texture, false otherwise.
+         * @param async True to decode the texture in the background, see Texture::create.
          *
          * @return The new sampler.
          * @script{create}
          */
-        static Sampler* create(const char* path, bool generateMipmaps = false);
+        static Sampler* create(const char* path, bool generateMipmaps = false, bool async = false);
 
         /**
          * Sets the wrap mode for this sampler.
@@ -174,13 +175,19 @@ public:
      * Note that for textures that include mipmap data in the source data (such as most compressed textures),
      * the generateMipmaps flags should NOT be set to true.
      *
+     * Textures are cached by resolved path and reused until their file changes.
+     *
+     * When async is true a PNG texture is decoded on a worker thread. The returned texture
+     * holds a single placeholder texel until the image has been uploaded by finishAsyncLoads.
+     *
      * @param path The image resource path.
      * @param generateMipmaps true to auto-generate a full mipmap chain, false otherwise.
+     * @param async true to decode the image in the background, false to load it now.
      * 
      * @return The new texture, or NULL if the texture could not be loaded/created.
      * @script{create}
      */
-    static Texture* create(const char* path, bool generateMipmaps = false);
+    static Texture* create(const char* path, bool generateMipmaps = false, bool async = false);
 
     /**
      * Creates a texture from the given image.
@@ -241,6 +248,13 @@ public:
      */
     void setData(const unsigned char* data);
 
+    /**
+     * Uploads the textures whose background decode has finished.
+     *
+     * Called by the game once per frame, on the thread that owns the graphics context.
+     */
+    static void finishAsyncLoads();
+
     /**
      * Returns the path that the texture was originally loaded from (if applicable).
      *
@@ -326,6 +340,8 @@ private:
 
     static Texture* createCompressedDDS(const char* path);
 
+    static Texture* createAsync(const char* path, bool generateMipmaps);
+
     static GLubyte* readCompressedPVRTC(const char* path, Stream* stream, GLsizei* width, GLsizei* height, GLenum* format, unsigned int* mipMapCount, unsigned int* faceCount, GLenum faces[6]);
 
     static GLubyte* readCompressedPVRTCLegacy(const char* path, Stream* stream, GLsizei* width, GLsizei* height, GLenum* format, unsigned int* mipMapCount, unsigned int* faceCount, GLenum faces[6]);
@@ -336,6 +352,8 @@ private:
     static size_t getFormatBPP(Format format);
 
     std::string _path;
+    std::string _cacheKey;
+    time_t _modifiedTime;
     TextureHandle _handle;
     Format _format;
     Type _type;
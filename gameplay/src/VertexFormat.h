@@ -35,13 +35,27 @@ public:
         TEXCOORD7 = 15
     };
 
+    /**
+     * Defines the data types of the values in vertex elements.
+     */
+    enum Type
+    {
+        FLOAT = 0,
+        HALF_FLOAT = 1,
+        BYTE = 2,
+        UNSIGNED_BYTE = 3,
+        SHORT = 4,
+        UNSIGNED_SHORT = 5
+    };
+
     /**
      * Defines a single element within a vertex format.
      *
-     * All vertex elements are assumed to be of type float, but can
-     * have a varying number of float values (1-4), which is represented
-     * by the size attribute. Additionally, vertex elements are assumed
-     * to be tightly packed.
+     * Vertex elements are of type float unless another type is given,
+     * and can have a varying number of values (1-4), which is represented
+     * by the size attribute. Integer values can be normalized to [0, 1]
+     * or [-1, 1] when read by the shader. Additionally, vertex elements
+     * are assumed to be tightly packed.
      */
     class Element
     {
@@ -56,6 +70,16 @@ public:
          */
         unsigned int size;
 
+        /**
+         * The data type of the values in the vertex element.
+         */
+        Type type;
+
+        /**
+         * Whether integer values are normalized when read by the shader.
+         */
+        bool normalized;
+
         /**
          * Constructor.
          */
@@ -69,6 +93,23 @@ public:
          */
         Element(Usage usage, unsigned int size);
 
+        /**
+         * Constructor.
+         *
+         * @param usage The vertex element usage semantic.
+         * @param size The number of values in the vertex element.
+         * @param type The data type of the values.
+         * @param normalized Whether integer values are normalized when read by the shader.
+         */
+        Element(Usage usage, unsigned int size, Type type, bool normalized = false);
+
+        /**
+         * Returns the size of the vertex element in bytes.
+         *
+         * @return The size of the vertex element in bytes.
+         */
+        unsigned int getSizeInBytes() const;
+
         /**
          * Compares two vertex elements for equality.
          *